@@ -68,6 +68,21 @@ typedef cpBool (*cpHashSetFilterFunc)(void *elt, void *data);
 void cpHashSetFilter(cpHashSet *set, cpHashSetFilterFunc func, void *data);
 
 
+//MARK: cpArbiterCache
+
+// Default capacity, enough for every cached pair of a small scene without growing.
+#define CP_ARBITER_CACHE_CAPACITY 32
+
+cpArbiterCache *cpArbiterCacheNew(int capacity);
+void cpArbiterCacheFree(cpArbiterCache *cache);
+
+cpArbiter *cpArbiterCacheInsert(cpArbiterCache *cache, cpHashValue hash, const cpShape **shapes, cpHashSetTransFunc trans, void *data);
+cpArbiter *cpArbiterCacheRemove(cpArbiterCache *cache, cpHashValue hash, const cpShape **shapes);
+cpArbiter *cpArbiterCacheFind(cpArbiterCache *cache, cpHashValue hash, const cpShape **shapes);
+
+void cpArbiterCacheFilter(cpArbiterCache *cache, cpHashSetFilterFunc func, void *data);
+
+
 //MARK: Bodies
 
 void cpBodyAddShape(cpBody *body, cpShape *shape);
@@ -301,7 +316,7 @@ cpSpaceUncacheArbiter(cpSpace *space, cpArbiter *arb)
 	const cpShape *a = arb->a, *b = arb->b;
 	const cpShape *shape_pair[] = {a, b};
 	cpHashValue arbHashID = CP_HASH_PAIR((cpHashValue)a, (cpHashValue)b);
-	cpHashSetRemove(space->cachedArbiters, arbHashID, shape_pair);
+	cpArbiterCacheRemove(space->cachedArbiters, arbHashID, shape_pair);
 	cpArrayDeleteObj(space->arbiters, arb);
 }
 
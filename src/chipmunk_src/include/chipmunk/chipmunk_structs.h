@@ -391,8 +391,15 @@ struct cpSimpleMotor {
 };
 
 typedef struct cpContactBufferHeader cpContactBufferHeader;
+typedef struct cpArbiterCache cpArbiterCache;
 typedef void (*cpSpaceArbiterApplyImpulseFunc)(cpArbiter *arb);
 
+// Collision handlers are resolved into a dense table indexed by collision type slots.
+// Slot 0 collects every type without handlers, slot 1 is the wildcard type.
+// Types not below CP_HANDLER_TABLE_DIRECT_TYPES or too many types fall back to the hash set.
+#define CP_HANDLER_TABLE_SLOTS 8
+#define CP_HANDLER_TABLE_DIRECT_TYPES 64
+
 struct cpSpace {
 	int iterations;
 	
@@ -424,7 +431,7 @@ struct cpSpace {
 	
 	cpArray *arbiters;
 	cpContactBufferHeader *contactBuffersHead;
-	cpHashSet *cachedArbiters;
+	cpArbiterCache *cachedArbiters;
 	cpArray *pooledArbiters;
 	
 	cpArray *allocatedBuffers;
@@ -434,6 +441,12 @@ struct cpSpace {
 	cpHashSet *collisionHandlers;
 	cpCollisionHandler defaultHandler;
 	
+	cpBool handlerTableValid;
+	int handlerSlotCount;
+	cpCollisionType handlerSlotTypes[CP_HANDLER_TABLE_SLOTS];
+	unsigned char handlerSlots[CP_HANDLER_TABLE_DIRECT_TYPES];
+	cpCollisionHandler *handlerTable[CP_HANDLER_TABLE_SLOTS][CP_HANDLER_TABLE_SLOTS];
+	
 	cpBool skipPostStep;
 	cpArray *postStepCallbacks;
 	
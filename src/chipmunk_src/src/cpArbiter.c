@@ -343,11 +343,23 @@ cpArbiterInit(cpArbiter *arb, cpShape *a, cpShape *b)
 	return arb;
 }
 
+static inline int
+cpSpaceHandlerSlot(const cpSpace *space, cpCollisionType type)
+{
+	if(type < CP_HANDLER_TABLE_DIRECT_TYPES) return space->handlerSlots[type];
+	return (type == CP_WILDCARD_COLLISION_TYPE ? 1 : 0);
+}
+
 static inline cpCollisionHandler *
 cpSpaceLookupHandler(cpSpace *space, cpCollisionType a, cpCollisionType b, cpCollisionHandler *defaultValue)
 {
-	cpCollisionType types[] = {a, b};
-	cpCollisionHandler *handler = (cpCollisionHandler *)cpHashSetFind(space->collisionHandlers, CP_HASH_PAIR(a, b), types);
+	cpCollisionHandler *handler;
+	if(space->handlerTableValid){
+		handler = space->handlerTable[cpSpaceHandlerSlot(space, a)][cpSpaceHandlerSlot(space, b)];
+	} else {
+		cpCollisionType types[] = {a, b};
+		handler = (cpCollisionHandler *)cpHashSetFind(space->collisionHandlers, CP_HASH_PAIR(a, b), types);
+	}
 	return (handler ? handler : defaultValue);
 }
 
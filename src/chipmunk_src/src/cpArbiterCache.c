@@ -0,0 +1,199 @@
+/* Copyright (c) 2013 Scott Lembcke and Howling Moon Software
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "chipmunk/chipmunk_private.h"
+
+// Flat arbiter cache keyed by shape pair.
+// Arbiters and their hashes are stored densely, so filtering is a linear pass without chasing bins.
+// Lookup goes through an open addressing index with linear probing, slot holds dense index + 1, 0 is empty.
+// All storage is a single allocation, which is only replaced when the capacity is exceeded.
+struct cpArbiterCache {
+	int count, capacity;
+	unsigned int mask;
+	
+	cpArbiter **arbiters;
+	cpHashValue *hashes;
+	unsigned int *slots;
+};
+
+static inline unsigned int
+homeSlot(const cpArbiterCache *cache, cpHashValue hash)
+{
+	return (unsigned int)(hash ^ (hash >> 16))&cache->mask;
+}
+
+static inline cpBool
+arbiterEql(const cpArbiter *arb, const cpShape **shapes)
+{
+	const cpShape *a = shapes[0];
+	const cpShape *b = shapes[1];
+	
+	return ((a == arb->a && b == arb->b) || (b == arb->a && a == arb->b));
+}
+
+static void
+cacheAllocStorage(cpArbiterCache *cache, int capacity)
+{
+	// Index is kept at most half full to keep probe sequences short.
+	unsigned int slotCount = 1;
+	while(slotCount < 2*(unsigned int)capacity) slotCount <<= 1;
+	
+	size_t bytes = capacity*(sizeof(cpArbiter *) + sizeof(cpHashValue)) + slotCount*sizeof(unsigned int);
+	void *storage = cpcalloc(1, bytes);
+	
+	cache->count = 0;
+	cache->capacity = capacity;
+	cache->mask = slotCount - 1;
+	
+	cache->arbiters = (cpArbiter **)storage;
+	cache->hashes = (cpHashValue *)(cache->arbiters + capacity);
+	cache->slots = (unsigned int *)(cache->hashes + capacity);
+}
+
+static void
+cachePush(cpArbiterCache *cache, cpHashValue hash, cpArbiter *arb)
+{
+	int idx = cache->count++;
+	cache->arbiters[idx] = arb;
+	cache->hashes[idx] = hash;
+	
+	unsigned int slot = homeSlot(cache, hash);
+	while(cache->slots[slot]) slot = (slot + 1)&cache->mask;
+	cache->slots[slot] = idx + 1;
+}
+
+// Returns slot of the matching arbiter or -1.
+static inline int
+cacheFindSlot(const cpArbiterCache *cache, cpHashValue hash, const cpShape **shapes)
+{
+	unsigned int slot = homeSlot(cache, hash);
+	while(cache->slots[slot]){
+		int idx = cache->slots[slot] - 1;
+		if(cache->hashes[idx] == hash && arbiterEql(cache->arbiters[idx], shapes)) return (int)slot;
+		slot = (slot + 1)&cache->mask;
+	}
+	
+	return -1;
+}
+
+static unsigned int
+cacheSlotOfIndex(const cpArbiterCache *cache, int idx)
+{
+	unsigned int slot = homeSlot(cache, cache->hashes[idx]);
+	while(cache->slots[slot] != (unsigned int)idx + 1) slot = (slot + 1)&cache->mask;
+	return slot;
+}
+
+// Remove entry stored in the slot, the last dense entry takes its place.
+static void
+cacheRemoveSlot(cpArbiterCache *cache, unsigned int slot)
+{
+	int idx = cache->slots[slot] - 1;
+	int last = --cache->count;
+	if(idx != last){
+		cache->slots[cacheSlotOfIndex(cache, last)] = idx + 1;
+		cache->arbiters[idx] = cache->arbiters[last];
+		cache->hashes[idx] = cache->hashes[last];
+	}
+	
+	// Backward shift deletion, keeps probe sequences valid without tombstones.
+	unsigned int hole = slot;
+	for(unsigned int next = (hole + 1)&cache->mask; cache->slots[next]; next = (next + 1)&cache->mask){
+		unsigned int home = homeSlot(cache, cache->hashes[cache->slots[next] - 1]);
+		// Entry may fill the hole only if its home is not cyclically inside (hole, next].
+		if(((next - home)&cache->mask) >= ((next - hole)&cache->mask)){
+			cache->slots[hole] = cache->slots[next];
+			hole = next;
+		}
+	}
+	cache->slots[hole] = 0;
+}
+
+cpArbiterCache *
+cpArbiterCacheNew(int capacity)
+{
+	cpArbiterCache *cache = (cpArbiterCache *)cpcalloc(1, sizeof(cpArbiterCache));
+	cacheAllocStorage(cache, capacity > 0 ? capacity : CP_ARBITER_CACHE_CAPACITY);
+	return cache;
+}
+
+void
+cpArbiterCacheFree(cpArbiterCache *cache)
+{
+	if(cache){
+		cpfree(cache->arbiters);
+		cpfree(cache);
+	}
+}
+
+cpArbiter *
+cpArbiterCacheInsert(cpArbiterCache *cache, cpHashValue hash, const cpShape **shapes, cpHashSetTransFunc trans, void *data)
+{
+	int slot = cacheFindSlot(cache, hash, shapes);
+	if(slot >= 0) return cache->arbiters[cache->slots[slot] - 1];
+	
+	if(cache->count == cache->capacity){
+		// Scene outgrew the cache, rebuild it twice as large.
+		int count = cache->count;
+		cpArbiter **arbiters = cache->arbiters;
+		cpHashValue *hashes = cache->hashes;
+		
+		cacheAllocStorage(cache, 2*cache->capacity);
+		for(int i=0; i<count; i++) cachePush(cache, hashes[i], arbiters[i]);
+		cpfree(arbiters);
+	}
+	
+	cpArbiter *arb = (cpArbiter *)(trans ? trans((void *)shapes, data) : data);
+	cachePush(cache, hash, arb);
+	return arb;
+}
+
+cpArbiter *
+cpArbiterCacheRemove(cpArbiterCache *cache, cpHashValue hash, const cpShape **shapes)
+{
+	int slot = cacheFindSlot(cache, hash, shapes);
+	if(slot < 0) return NULL;
+	
+	cpArbiter *arb = cache->arbiters[cache->slots[slot] - 1];
+	cacheRemoveSlot(cache, (unsigned int)slot);
+	return arb;
+}
+
+cpArbiter *
+cpArbiterCacheFind(cpArbiterCache *cache, cpHashValue hash, const cpShape **shapes)
+{
+	int slot = cacheFindSlot(cache, hash, shapes);
+	return (slot >= 0 ? cache->arbiters[cache->slots[slot] - 1] : NULL);
+}
+
+void
+cpArbiterCacheFilter(cpArbiterCache *cache, cpHashSetFilterFunc func, void *data)
+{
+	for(int i=0; i<cache->count;){
+		if(func(cache->arbiters[i], data)){
+			i++;
+		} else {
+			// The last entry is moved to i, so i is checked again.
+			cacheRemoveSlot(cache, cacheSlotOfIndex(cache, i));
+		}
+	}
+}
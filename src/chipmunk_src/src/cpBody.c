@@ -609,9 +609,31 @@ cpBodyEachConstraint(cpBody *body, cpBodyConstraintIteratorFunc func, void *data
 	}
 }
 
+static void
+cpBodyEachArbiterNoSleep(cpBody *body, cpBodyArbiterIteratorFunc func, void *data)
+{
+	// Contact graph is not threaded when sleeping is disabled.
+	// Reverse order matches the order arbiters would have been pushed to the body's list.
+	cpArray *arbiters = body->space->arbiters;
+	for(int i=arbiters->num - 1; i>=0; i--){
+		cpArbiter *arb = (cpArbiter *)arbiters->arr[i];
+		if(arb->body_a != body && arb->body_b != body) continue;
+		
+		cpBool swapped = arb->swapped; {
+			arb->swapped = (body == arb->body_b);
+			func(body, arb, data);
+		} arb->swapped = swapped;
+	}
+}
+
 void
 cpBodyEachArbiter(cpBody *body, cpBodyArbiterIteratorFunc func, void *data)
 {
+	if(body->space && body->space->sleepTimeThreshold == INFINITY){
+		cpBodyEachArbiterNoSleep(body, func, data);
+		return;
+	}
+	
 	cpArbiter *arb = body->arbiterList;
 	while(arb){
 		cpArbiter *next = cpArbiterNext(arb, body);
@@ -471,6 +471,26 @@ GJK(const struct SupportContext *ctx, cpCollisionID *id)
 	return points;
 }
 
+// Check if the closest features cached in the collision id from the last frame still separate two shapes
+// by more than mindist. The separating axis is taken from the cached minkowski edge, which is cheaper than running GJK.
+static inline cpBool
+CachedAxisSeparates(const struct SupportContext *ctx, const cpCollisionID id, const cpFloat mindist)
+{
+	if(!id) return cpFalse;
+	
+	struct MinkowskiPoint v0 = MinkowskiPointNew(ShapePoint(ctx->shape1, (id>>24)&0xFF), ShapePoint(ctx->shape2, (id>>16)&0xFF));
+	struct MinkowskiPoint v1 = MinkowskiPointNew(ShapePoint(ctx->shape1, (id>> 8)&0xFF), ShapePoint(ctx->shape2, (id    )&0xFF));
+	
+	cpVect p = (cpveql(v0.ab, v1.ab) ? v0.ab : LerpT(v0.ab, v1.ab, ClosestT(v0.ab, v1.ab)));
+	cpFloat d = cpvlength(p);
+	if(d <= mindist) return cpFalse;
+	
+	// The minkowski difference lies beyond the axis if its nearest point along the axis is still farther than mindist.
+	cpVect n = cpvmult(p, 1.0f/d);
+	struct MinkowskiPoint q = Support(ctx, cpvneg(n));
+	return cpvdot(q.ab, n) > mindist;
+}
+
 //MARK: Contact Clipping
 
 // Given two support edges, find contact point pairs on their surfaces.
@@ -607,6 +627,8 @@ static void
 PolyToPoly(const cpPolyShape *poly1, const cpPolyShape *poly2, struct cpCollisionInfo *info)
 {
 	struct SupportContext context = {(cpShape *)poly1, (cpShape *)poly2, (SupportPointFunc)PolySupportPoint, (SupportPointFunc)PolySupportPoint};
+	if(CachedAxisSeparates(&context, info->id, poly1->r + poly2->r)) return;
+	
 	struct ClosestPoints points = GJK(&context, &info->id);
 	
 #if DRAW_CLOSEST
@@ -630,6 +652,8 @@ static void
 SegmentToPoly(const cpSegmentShape *seg, const cpPolyShape *poly, struct cpCollisionInfo *info)
 {
 	struct SupportContext context = {(cpShape *)seg, (cpShape *)poly, (SupportPointFunc)SegmentSupportPoint, (SupportPointFunc)PolySupportPoint};
+	if(CachedAxisSeparates(&context, info->id, seg->r + poly->r)) return;
+	
 	struct ClosestPoints points = GJK(&context, &info->id);
 	
 #if DRAW_CLOSEST
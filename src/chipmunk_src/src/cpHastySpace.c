@@ -428,12 +428,13 @@ cpHastySpaceStep(cpSpace *space, cpFloat dt)
 		cpSpatialIndexReindexQuery(space->dynamicShapes, (cpSpatialIndexQueryFunc)cpSpaceCollideShapes, space);
 	} cpSpaceUnlock(space, cpFalse);
 	
-	// Rebuild the contact graph (and detect sleeping components if sleeping is enabled)
-	cpSpaceProcessComponents(space, dt);
+	// Rebuild the contact graph and detect sleeping components.
+	// Without sleeping nothing traverses the graph, cpBodyEachArbiter() walks space->arbiters instead.
+	if(space->sleepTimeThreshold != INFINITY) cpSpaceProcessComponents(space, dt);
 	
 	cpSpaceLock(space); {
 		// Clear out old cached arbiters and call separate callbacks
-		cpHashSetFilter(space->cachedArbiters, (cpHashSetFilterFunc)cpSpaceArbiterSetFilter, space);
+		cpArbiterCacheFilter(space->cachedArbiters, (cpHashSetFilterFunc)cpSpaceArbiterSetFilter, space);
 
 		// Prestep the arbiters and constraints.
 		cpFloat slop = space->collisionSlop;
@@ -26,16 +26,6 @@
 
 //MARK: Contact Set Helpers
 
-// Equal function for arbiterSet.
-static cpBool
-arbiterSetEql(cpShape **shapes, cpArbiter *arb)
-{
-	cpShape *a = shapes[0];
-	cpShape *b = shapes[1];
-	
-	return ((a == arb->a && b == arb->b) || (b == arb->a && a == arb->b));
-}
-
 //MARK: Collision Handler Set HelperFunctions
 
 // Equals function for collisionHandlers.
@@ -159,7 +149,7 @@ cpSpaceInit(cpSpace *space)
 	space->pooledArbiters = cpArrayNew(0);
 	
 	space->contactBuffersHead = NULL;
-	space->cachedArbiters = cpHashSetNew(0, (cpHashSetEqlFunc)arbiterSetEql);
+	space->cachedArbiters = cpArbiterCacheNew(CP_ARBITER_CACHE_CAPACITY);
 	
 	space->constraints = cpArrayNew(0);
 	
@@ -167,6 +157,13 @@ cpSpaceInit(cpSpace *space)
 	memcpy(&space->defaultHandler, &cpCollisionHandlerDoNothing, sizeof(cpCollisionHandler));
 	space->collisionHandlers = cpHashSetNew(0, (cpHashSetEqlFunc)handlerSetEql);
 	
+	space->handlerTableValid = cpTrue;
+	space->handlerSlotCount = 2;
+	space->handlerSlotTypes[0] = 0;
+	space->handlerSlotTypes[1] = CP_WILDCARD_COLLISION_TYPE;
+	memset(space->handlerSlots, 0, sizeof(space->handlerSlots));
+	memset(space->handlerTable, 0, sizeof(space->handlerTable));
+	
 	space->postStepCallbacks = cpArrayNew(0);
 	space->skipPostStep = cpFalse;
 	
@@ -200,7 +197,7 @@ cpSpaceDestroy(cpSpace *space)
 	
 	cpArrayFree(space->constraints);
 	
-	cpHashSetFree(space->cachedArbiters);
+	cpArbiterCacheFree(space->cachedArbiters);
 	
 	cpArrayFree(space->arbiters);
 	cpArrayFree(space->pooledArbiters);
@@ -379,6 +376,40 @@ cpSpaceIsLocked(cpSpace *space)
 
 //MARK: Collision Handler Function Management
 
+static void
+cpSpaceAddHandlerSlot(cpSpace *space, cpCollisionType type)
+{
+	if(type == CP_WILDCARD_COLLISION_TYPE) return;
+	
+	if(type >= CP_HANDLER_TABLE_DIRECT_TYPES){
+		space->handlerTableValid = cpFalse;
+	} else if(!space->handlerSlots[type]){
+		if(space->handlerSlotCount < CP_HANDLER_TABLE_SLOTS){
+			space->handlerSlotTypes[space->handlerSlotCount] = type;
+			space->handlerSlots[type] = (unsigned char)space->handlerSlotCount++;
+		} else {
+			space->handlerTableValid = cpFalse;
+		}
+	}
+}
+
+// Resolve every registered pair of types once, so arbiters never search the handler hash set.
+static void
+cpSpaceUpdateHandlerTable(cpSpace *space, cpCollisionType a, cpCollisionType b)
+{
+	cpSpaceAddHandlerSlot(space, a);
+	cpSpaceAddHandlerSlot(space, b);
+	if(!space->handlerTableValid) return;
+	
+	for(int i=1; i<space->handlerSlotCount; i++){
+		for(int j=1; j<space->handlerSlotCount; j++){
+			cpCollisionType types[] = {space->handlerSlotTypes[i], space->handlerSlotTypes[j]};
+			cpHashValue hash = CP_HASH_PAIR(types[0], types[1]);
+			space->handlerTable[i][j] = (cpCollisionHandler *)cpHashSetFind(space->collisionHandlers, hash, types);
+		}
+	}
+}
+
 static void
 cpSpaceUseWildcardDefaultHandler(cpSpace *space)
 {
@@ -399,7 +430,9 @@ cpCollisionHandler *cpSpaceAddCollisionHandler(cpSpace *space, cpCollisionType a
 {
 	cpHashValue hash = CP_HASH_PAIR(a, b);
 	cpCollisionHandler handler = {a, b, DefaultBegin, DefaultPreSolve, DefaultPostSolve, DefaultSeparate, NULL};
-	return (cpCollisionHandler*)cpHashSetInsert(space->collisionHandlers, hash, &handler, (cpHashSetTransFunc)handlerSetTrans, NULL);
+	cpCollisionHandler *ret = (cpCollisionHandler*)cpHashSetInsert(space->collisionHandlers, hash, &handler, (cpHashSetTransFunc)handlerSetTrans, NULL);
+	cpSpaceUpdateHandlerTable(space, a, b);
+	return ret;
 }
 
 cpCollisionHandler *
@@ -409,7 +442,9 @@ cpSpaceAddWildcardHandler(cpSpace *space, cpCollisionType type)
 	
 	cpHashValue hash = CP_HASH_PAIR(type, CP_WILDCARD_COLLISION_TYPE);
 	cpCollisionHandler handler = {type, CP_WILDCARD_COLLISION_TYPE, AlwaysCollide, AlwaysCollide, DoNothing, DoNothing, NULL};
-	return (cpCollisionHandler*)cpHashSetInsert(space->collisionHandlers, hash, &handler, (cpHashSetTransFunc)handlerSetTrans, NULL);
+	cpCollisionHandler *ret = (cpCollisionHandler*)cpHashSetInsert(space->collisionHandlers, hash, &handler, (cpHashSetTransFunc)handlerSetTrans, NULL);
+	cpSpaceUpdateHandlerTable(space, type, CP_WILDCARD_COLLISION_TYPE);
+	return ret;
 }
 
 
@@ -514,7 +549,7 @@ cpSpaceFilterArbiters(cpSpace *space, cpBody *body, cpShape *filter)
 {
 	cpSpaceLock(space); {
 		struct arbiterFilterContext context = {space, body, filter};
-		cpHashSetFilter(space->cachedArbiters, (cpHashSetFilterFunc)cachedArbitersFilter, &context);
+		cpArbiterCacheFilter(space->cachedArbiters, (cpHashSetFilterFunc)cachedArbitersFilter, &context);
 	} cpSpaceUnlock(space, cpTrue);
 }
 
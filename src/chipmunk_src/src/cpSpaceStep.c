@@ -248,7 +248,7 @@ cpSpaceCollideShapes(cpShape *a, cpShape *b, cpCollisionID id, cpSpace *space)
 	// This is where the persistant contact magic comes from.
 	const cpShape *shape_pair[] = {info.a, info.b};
 	cpHashValue arbHashID = CP_HASH_PAIR((cpHashValue)info.a, (cpHashValue)info.b);
-	cpArbiter *arb = (cpArbiter *)cpHashSetInsert(space->cachedArbiters, arbHashID, shape_pair, (cpHashSetTransFunc)cpSpaceArbiterSetTrans, space);
+	cpArbiter *arb = cpArbiterCacheInsert(space->cachedArbiters, arbHashID, shape_pair, (cpHashSetTransFunc)cpSpaceArbiterSetTrans, space);
 	cpArbiterUpdate(arb, &info, space);
 	
 	cpCollisionHandler *handler = arb->handler;
@@ -372,12 +372,13 @@ cpSpaceStep(cpSpace *space, cpFloat dt)
 		cpSpatialIndexReindexQuery(space->dynamicShapes, (cpSpatialIndexQueryFunc)cpSpaceCollideShapes, space);
 	} cpSpaceUnlock(space, cpFalse);
 	
-	// Rebuild the contact graph (and detect sleeping components if sleeping is enabled)
-	cpSpaceProcessComponents(space, dt);
+	// Rebuild the contact graph and detect sleeping components.
+	// Without sleeping nothing traverses the graph, cpBodyEachArbiter() walks space->arbiters instead.
+	if(space->sleepTimeThreshold != INFINITY) cpSpaceProcessComponents(space, dt);
 	
 	cpSpaceLock(space); {
 		// Clear out old cached arbiters and call separate callbacks
-		cpHashSetFilter(space->cachedArbiters, (cpHashSetFilterFunc)cpSpaceArbiterSetFilter, space);
+		cpArbiterCacheFilter(space->cachedArbiters, (cpHashSetFilterFunc)cpSpaceArbiterSetFilter, space);
 
 		// Prestep the arbiters and constraints.
 		cpFloat slop = space->collisionSlop;
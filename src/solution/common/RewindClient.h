@@ -2,10 +2,14 @@
 
 #if defined(LOCAL_RUN) && defined(ENABLE_VISUALISER)
 
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
 #include <cstdio>
 #include <string>
 #include <cstdint>
+#include <thread>
+#include <vector>
 
 #include <csimplesocket/ActiveSocket.h>
 
@@ -40,6 +44,9 @@ public:
     ///Default layer to draw primitives
     constexpr static int DEFAULT_LAYER = 3;
 
+    ///Frames which may wait for sender, strategy blocks only when all of them are queued
+    constexpr static size_t FRAMES_QUEUE = 64;
+
     enum Color : uint32_t {
         COLOR_RED = 0xFF0000,
         COLOR_GREEN = 0x00FF00,
@@ -62,18 +69,27 @@ public:
         return inst;
     }
 
+    ~RewindClient() {
+        stop_.store(true, std::memory_order_release);
+        sender_.join();
+    }
+
     /**
      * Should be send on end of move function
      * all turn primitives will be rendered after that point
+     * Frame is handed to sender thread, which serializes it and sends with single write
      */
     void end_frame() {
-        send(R"({"type":"end"})");
+        const size_t head = head_.load(std::memory_order_relaxed) + 1;
+        head_.store(head, std::memory_order_release);
+        //Next frame slot should be already sent
+        while (head - tail_.load(std::memory_order_acquire) >= FRAMES_QUEUE) {
+            std::this_thread::yield();
+        }
     }
 
     void circle(double x, double y, double r, uint32_t color, size_t layer = DEFAULT_LAYER) {
-        static const char *fmt =
-            R"({"type": "circle", "x": %lf, "y": %lf, "r": %lf, "color": %u, "layer": %u})";
-        send(format(fmt, x, y, r, color, layer));
+        push({primitive_t::CIRCLE, {x, y, r, 0.0}, color, static_cast<uint32_t>(layer), 0, 0});
     }
 
     void circle(vec2 center, double r, uint32_t color, size_t layer = DEFAULT_LAYER) {
@@ -81,21 +97,15 @@ public:
     }
 
     void popup(double x, double y, double r, std::string text) {
-        static const char *fmt =
-            R"({"type": "popup", "x": %lf, "y": %lf, "r": %lf, "text": "%s"})";
-        send(format(fmt, x, y, r, text.c_str()));
+        push_text({primitive_t::POPUP, {x, y, r, 0.0}, 0, 0, 0, 0}, text.c_str());
     }
 
     void rect(double x1, double y1, double x2, double y2, uint32_t color, size_t layer = DEFAULT_LAYER) {
-        static const char *fmt =
-            R"({"type": "rectangle", "x1": %lf, "y1": %lf, "x2": %lf, "y2": %lf, "color": %u, "layer": %u})";
-        send(format(fmt, x1, y1, x2, y2, color, layer));
+        push({primitive_t::RECT, {x1, y1, x2, y2}, color, static_cast<uint32_t>(layer), 0, 0});
     }
 
     void line(double x1, double y1, double x2, double y2, uint32_t color, size_t layer = DEFAULT_LAYER) {
-        static const char *fmt =
-            R"({"type": "line", "x1": %lf, "y1": %lf, "x2": %lf, "y2": %lf, "color": %u, "layer": %u})";
-        send(format(fmt, x1, y1, x2, y2, color, layer));
+        push({primitive_t::LINE, {x1, y1, x2, y2}, color, static_cast<uint32_t>(layer), 0, 0});
     }
 
     void line(vec2 p1, vec2 p2, uint32_t color, size_t layer = DEFAULT_LAYER) {
@@ -107,22 +117,43 @@ public:
      * Message content displayed in separate window inside viewer
      * Can be used several times per frame
      * It can be used like printf, e.g.: message("This %s will be %s", "string", "formatted")
+     * Only formatting of message itself happens in caller thread
      */
     template<typename... Args>
     void message(Args... args) {
-        std::string s = R"({"type": "message", "message": ")";
-        s += format(args...);
-        s += "\"}\n";
-        send(s);
+        push_text({primitive_t::MESSAGE, {0.0, 0.0, 0.0, 0.0}, 0, 0, 0, 0}, format(args...));
     }
 
 private:
+    ///Primitive as it was requested, json is built by sender thread
+    struct primitive_t {
+        enum Type : uint8_t {
+            CIRCLE,
+            RECT,
+            LINE,
+            POPUP,
+            MESSAGE,
+        };
+
+        Type type;
+        double v[4];
+        uint32_t color;
+        uint32_t layer;
+        ///Text of popup and message in frame text buffer
+        uint32_t text_offset;
+        uint32_t text_size;
+    };
+
+    struct frame_t {
+        std::vector<primitive_t> primitives;
+        std::string text;
+    };
+
     template<typename... Args>
-    static inline std::string format(const char *fmt, Args... args) {
+    static inline const char *format(const char *fmt, Args... args) {
         static char buf[2048];
-        int bytes = sprintf(buf, fmt, args...);
-        buf[bytes] = '\0';
-        return std::string(buf);
+        snprintf(buf, sizeof(buf), fmt, args...);
+        return buf;
     }
 
     RewindClient(const std::string &host, uint16_t port) {
@@ -131,13 +162,95 @@ private:
         if (!socket_.Open(reinterpret_cast<const uint8_t *>(host.c_str()), port)) {
             fprintf(stderr, "RewindClient:: Cannot open viewer socket. Launch viewer before strategy");
         }
+        sender_ = std::thread([this] { send_loop(); });
+    }
+
+    ///Only strategy thread writes to the frame at head, until it is published by end_frame
+    inline frame_t &current_frame() {
+        return frames_[head_.load(std::memory_order_relaxed) % FRAMES_QUEUE];
     }
 
-    void send(const std::string &buf) {
-        socket_.Send(reinterpret_cast<const uint8_t *>(buf.c_str()), buf.size());
+    inline void push(const primitive_t &p) {
+        current_frame().primitives.push_back(p);
+    }
+
+    inline void push_text(primitive_t p, const char *text) {
+        auto &frame = current_frame();
+        p.text_offset = static_cast<uint32_t>(frame.text.size());
+        frame.text += text;
+        p.text_size = static_cast<uint32_t>(frame.text.size()) - p.text_offset;
+        frame.primitives.push_back(p);
+    }
+
+    void send_loop() {
+        std::string out;
+        while (true) {
+            const size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail == head_.load(std::memory_order_acquire)) {
+                if (stop_.load(std::memory_order_acquire)) {
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                continue;
+            }
+
+            auto &frame = frames_[tail % FRAMES_QUEUE];
+            out.clear();
+            serialize(frame, out);
+            socket_.Send(reinterpret_cast<const uint8_t *>(out.data()), out.size());
+            frame.primitives.clear();
+            frame.text.clear();
+            tail_.store(tail + 1, std::memory_order_release);
+        }
+    }
+
+    static void serialize(const frame_t &frame, std::string &out) {
+        char buf[256];
+        for (const auto &p : frame.primitives) {
+            switch (p.type) {
+                case primitive_t::CIRCLE:
+                    snprintf(buf, sizeof(buf),
+                             R"({"type": "circle", "x": %lf, "y": %lf, "r": %lf, "color": %u, "layer": %u})",
+                             p.v[0], p.v[1], p.v[2], p.color, p.layer);
+                    out += buf;
+                    break;
+                case primitive_t::RECT:
+                    snprintf(buf, sizeof(buf),
+                             R"({"type": "rectangle", "x1": %lf, "y1": %lf, "x2": %lf, "y2": %lf, "color": %u, "layer": %u})",
+                             p.v[0], p.v[1], p.v[2], p.v[3], p.color, p.layer);
+                    out += buf;
+                    break;
+                case primitive_t::LINE:
+                    snprintf(buf, sizeof(buf),
+                             R"({"type": "line", "x1": %lf, "y1": %lf, "x2": %lf, "y2": %lf, "color": %u, "layer": %u})",
+                             p.v[0], p.v[1], p.v[2], p.v[3], p.color, p.layer);
+                    out += buf;
+                    break;
+                case primitive_t::POPUP:
+                    snprintf(buf, sizeof(buf), R"({"type": "popup", "x": %lf, "y": %lf, "r": %lf, "text": ")",
+                             p.v[0], p.v[1], p.v[2]);
+                    out += buf;
+                    out.append(frame.text, p.text_offset, p.text_size);
+                    out += "\"}";
+                    break;
+                case primitive_t::MESSAGE:
+                    out += R"({"type": "message", "message": ")";
+                    out.append(frame.text, p.text_offset, p.text_size);
+                    out += "\"}\n";
+                    break;
+            }
+        }
+        out += R"({"type":"end"})";
     }
 
     CActiveSocket socket_;
+
+    frame_t frames_[FRAMES_QUEUE];
+    ///Count of frames published by strategy and sent by sender thread
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<bool> stop_{false};
+    std::thread sender_;
 };
 
 #define VIS_LINE(...) RewindClient::instance().line(__VA_ARGS__);
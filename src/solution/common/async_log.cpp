@@ -0,0 +1,222 @@
+#ifdef ENABLE_LOG
+
+#include "async_log.h"
+
+#include <chrono>
+#include <cstdio>
+
+using namespace async_log;
+
+namespace {
+
+constexpr size_t k_line_size = 2048;
+constexpr size_t k_spec_size = 32;
+
+///Appends printf output to line, keeps it terminated when it overflows
+template<typename ...Args>
+void append(char *line, size_t &pos, const char *format, Args... args) {
+    if (pos + 1 >= k_line_size) {
+        return;
+    }
+    const int written = snprintf(line + pos, k_line_size - pos, format, args...);
+    if (written > 0) {
+        pos = std::min(pos + written, k_line_size - 1);
+    }
+}
+
+///Prints single argument by conversion spec of original format.
+///Length modifiers are dropped from spec, argument is always passed as 64 bit or double
+void append_arg(char *line, size_t &pos, const event_t &event, const arg_t *arg, char *spec, size_t spec_len) {
+    const char conv = spec[spec_len - 1];
+    if (!arg) {
+        append(line, pos, "<missing %c>", conv);
+        return;
+    }
+
+    switch (conv) {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X': {
+            //Reinsert 64 bit length modifier before conversion
+            spec[spec_len - 1] = 'l';
+            spec[spec_len] = 'l';
+            spec[spec_len + 1] = conv;
+            spec[spec_len + 2] = '\0';
+            const int64_t v = arg->kind == arg_t::kind_t::DOUBLE ? static_cast<int64_t>(arg->d) : arg->i;
+            append(line, pos, spec, static_cast<long long>(v));
+            break;
+        }
+        case 'c':
+            append(line, pos, spec, static_cast<int>(arg->i));
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            append(line, pos, spec, arg->kind == arg_t::kind_t::DOUBLE ? arg->d : static_cast<double>(arg->i));
+            break;
+        case 's':
+            append(line, pos, spec, arg->kind == arg_t::kind_t::STR ? event.strings + arg->str : "<?>");
+            break;
+        case 'p':
+            append(line, pos, spec, arg->p);
+            break;
+        default:
+            append(line, pos, "%s", spec);
+            break;
+    }
+}
+
+} // anonymous namespace
+
+Backend &Backend::instance() {
+    static Backend inst;
+    return inst;
+}
+
+Backend::~Backend() {
+    stop();
+}
+
+void Backend::start() {
+    if (running_.load(std::memory_order_acquire)) {
+        return;
+    }
+    stop_.store(false, std::memory_order_release);
+    writer_ = std::thread([this] { write_loop(); });
+    running_.store(true, std::memory_order_release);
+}
+
+void Backend::stop() {
+    if (!running_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    stop_.store(true, std::memory_order_release);
+    writer_.join();
+    drain();
+}
+
+void Backend::flush() {
+    if (!running_.load(std::memory_order_acquire)) {
+        return;
+    }
+    for (;;) {
+        bool empty = true;
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            for (const auto &ring : rings_) {
+                empty &= ring->empty();
+            }
+        }
+        if (empty) {
+            //Writer pops event only after it is written
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+ThreadRing &Backend::local_ring() {
+    thread_local std::shared_ptr<ThreadRing> ring;
+    if (!ring) {
+        ring = std::make_shared<ThreadRing>();
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.push_back(ring);
+    }
+    return *ring;
+}
+
+void Backend::write_loop() {
+    while (!stop_.load(std::memory_order_acquire)) {
+        if (!drain()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    }
+}
+
+bool Backend::drain() {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    bool written = false;
+    for (size_t i = 0; i < rings_.size();) {
+        auto &ring = *rings_[i];
+        //Bounded batch per ring, so one busy thread does not starve others
+        for (uint32_t n = 0; n < ThreadRing::CAPACITY; ++n) {
+            const event_t *event = ring.front();
+            if (!event) {
+                break;
+            }
+            write(*event);
+            ring.pop();
+            written = true;
+        }
+        if (const uint64_t dropped = ring.take_dropped()) {
+            loguru::log(loguru::Verbosity_WARNING, __FILE__, __LINE__,
+                        "%llu log events dropped, writer is behind", static_cast<unsigned long long>(dropped));
+        }
+
+        //Thread which owned the ring is gone and nothing is left to write
+        if (rings_[i].use_count() == 1 && ring.empty()) {
+            rings_.erase(rings_.begin() + i);
+        } else {
+            ++i;
+        }
+    }
+    return written;
+}
+
+void Backend::write(const event_t &event) {
+    char line[k_line_size];
+    size_t pos = 0;
+    line[0] = '\0';
+
+    int next_arg = 0;
+    const char *f = event.format;
+    while (*f) {
+        if (*f != '%') {
+            const char *text = f;
+            while (*f && *f != '%') {
+                ++f;
+            }
+            const size_t len = std::min(static_cast<size_t>(f - text), k_line_size - 1 - pos);
+            std::memcpy(line + pos, text, len);
+            pos += len;
+            line[pos] = '\0';
+            continue;
+        }
+        if (f[1] == '%') {
+            append(line, pos, "%%");
+            f += 2;
+            continue;
+        }
+
+        //Copy flags, width and precision, skip length modifiers, keep conversion
+        char spec[k_spec_size];
+        size_t spec_len = 0;
+        spec[spec_len++] = *f++;
+        while (*f && strchr("-+ #0123456789.", *f) && spec_len < k_spec_size - 4) {
+            spec[spec_len++] = *f++;
+        }
+        while (*f && strchr("hlLqjzt", *f)) {
+            ++f;
+        }
+        if (!*f) {
+            break;
+        }
+        spec[spec_len++] = *f++;
+        spec[spec_len] = '\0';
+
+        const arg_t *arg = next_arg < event.arg_count ? &event.args[next_arg++] : nullptr;
+        append_arg(line, pos, event, arg, spec, spec_len);
+    }
+
+    loguru::log(event.verbosity, event.file, event.line, "%s", line);
+}
+
+#endif
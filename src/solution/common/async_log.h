@@ -0,0 +1,210 @@
+#pragma once
+
+#ifdef ENABLE_LOG
+
+#include <loguru.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+///Asynchronous backend of LOG_* macros.
+///Caller only copies format pointer and raw arguments into its own thread ring,
+///printf formatting and loguru sinks (stderr, strategy.log) run on a writer thread.
+///Until start() is called, and after stop(), events are written synchronously.
+namespace async_log {
+
+constexpr int MAX_ARGS = 10;
+///Inline storage for all string arguments of an event, longer strings are truncated
+constexpr int STRINGS_SIZE = 256;
+
+struct arg_t {
+    enum class kind_t : uint8_t {
+        INT,
+        UINT,
+        DOUBLE,
+        PTR,
+        STR,
+    };
+
+    kind_t kind;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const void *p;
+        ///Offset in event strings
+        uint16_t str;
+    };
+};
+
+///Log call as it was made, format and file are string literals so pointers stay valid
+struct event_t {
+    const char *format;
+    const char *file;
+    uint32_t line;
+    int8_t verbosity;
+    uint8_t arg_count;
+    uint16_t strings_used;
+    arg_t args[MAX_ARGS];
+    char strings[STRINGS_SIZE];
+
+    template<typename T>
+    void capture(T value) {
+        arg_t &arg = args[arg_count++];
+        using type = std::decay_t<T>;
+        if constexpr (std::is_same_v<type, char *> || std::is_same_v<type, const char *>) {
+            arg.kind = arg_t::kind_t::STR;
+            arg.str = strings_used;
+            const size_t avail = STRINGS_SIZE - strings_used - 1;
+            const size_t len = value ? strnlen(value, avail) : 0;
+            std::memcpy(strings + strings_used, value, len);
+            strings[strings_used + len] = '\0';
+            strings_used = static_cast<uint16_t>(std::min<size_t>(strings_used + len + 1, STRINGS_SIZE - 1));
+        } else if constexpr (std::is_enum_v<type>) {
+            arg.kind = arg_t::kind_t::INT;
+            arg.i = static_cast<int64_t>(value);
+        } else if constexpr (std::is_floating_point_v<type>) {
+            arg.kind = arg_t::kind_t::DOUBLE;
+            arg.d = value;
+        } else if constexpr (std::is_integral_v<type> && std::is_signed_v<type>) {
+            arg.kind = arg_t::kind_t::INT;
+            arg.i = value;
+        } else if constexpr (std::is_integral_v<type>) {
+            arg.kind = arg_t::kind_t::UINT;
+            arg.u = value;
+        } else {
+            static_assert(std::is_pointer_v<type>, "Only printf compatible arguments can be logged");
+            arg.kind = arg_t::kind_t::PTR;
+            arg.p = value;
+        }
+    }
+};
+
+///Single producer single consumer queue of events, owned by one logging thread
+class ThreadRing {
+public:
+    static constexpr uint32_t CAPACITY = 1024;
+
+    ///Free slot at head, nullptr if writer is behind by whole ring
+    event_t *claim() {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == CAPACITY) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &events_[head % CAPACITY];
+    }
+
+    void publish() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    const event_t *front() const {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        return tail == head_.load(std::memory_order_acquire) ? nullptr : &events_[tail % CAPACITY];
+    }
+
+    void pop() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire);
+    }
+
+    uint64_t take_dropped() {
+        return dropped_.exchange(0, std::memory_order_relaxed);
+    }
+
+private:
+    alignas(64) std::atomic<uint32_t> head_{0};
+    alignas(64) std::atomic<uint32_t> tail_{0};
+    std::atomic<uint64_t> dropped_{0};
+    event_t events_[CAPACITY];
+};
+
+class Backend {
+public:
+    Backend(const Backend &) = delete;
+    Backend &operator=(const Backend &) = delete;
+
+    static Backend &instance();
+
+    ~Backend();
+
+    ///Launch writer thread, should be called after loguru sinks are set up
+    void start();
+
+    ///Write everything queued and return to synchronous mode
+    void stop();
+
+    ///Block until every event queued so far is written
+    void flush();
+
+    template<typename ...Args>
+    void push(int verbosity, const char *file, unsigned line, const char *format, Args... args) {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "Too many log arguments");
+        event_t local;
+        event_t *event = &local;
+        ThreadRing *ring = running_.load(std::memory_order_acquire) ? &local_ring() : nullptr;
+        if (ring) {
+            event = ring->claim();
+            if (!event) {
+                return;
+            }
+        }
+        event->format = format;
+        event->file = file;
+        event->line = line;
+        event->verbosity = static_cast<int8_t>(verbosity);
+        event->arg_count = 0;
+        event->strings_used = 0;
+        (event->capture(args), ...);
+
+        if (ring) {
+            ring->publish();
+        } else {
+            write(*event);
+        }
+    }
+
+private:
+    Backend() = default;
+
+    ThreadRing &local_ring();
+
+    void write_loop();
+
+    ///Format event and hand it to loguru
+    static void write(const event_t &event);
+
+    ///Write all queued events, returns whether anything was written
+    bool drain();
+
+    std::mutex rings_mutex_;
+    ///Rings of threads which have logged anything, a ring outlives its thread until it is drained
+    std::vector<std::shared_ptr<ThreadRing>> rings_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stop_{false};
+    std::thread writer_;
+};
+
+///Never called, only lets compiler check arguments against format as it does for LOG_F
+int check_format(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+} // namespace async_log
+
+#define ASYNC_LOG_F(verbosity_name, format, ...)                                                        \
+    ((void) sizeof(async_log::check_format(format, ##__VA_ARGS__)),                                     \
+     (loguru::Verbosity_##verbosity_name > loguru::current_verbosity_cutoff()) ? (void) 0 :             \
+     async_log::Backend::instance().push(loguru::Verbosity_##verbosity_name, __FILE__, __LINE__,        \
+                                         format, ##__VA_ARGS__))
+
+#endif
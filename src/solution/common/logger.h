@@ -6,21 +6,22 @@
 
 #ifdef ENABLE_LOG
 
-#include <loguru.hpp>
+#include "async_log.h"
 
-#define LOG_INFO(format, ...)   LOG_F(INFO,      format, ##__VA_ARGS__);
-#define LOG_WARN(format, ...)   LOG_F(WARNING,   format, ##__VA_ARGS__);
-#define LOG_ERROR(format, ...)  LOG_F(ERROR,     format, ##__VA_ARGS__);
-#define LOG_FATAL(format, ...)  LOG_F(FATAL,     format, ##__VA_ARGS__);
-#define LOG_DEBUG(format, ...)  LOG_F(1,         format, ##__VA_ARGS__);
-#define LOG_V2(format, ...)     LOG_F(2,         format, ##__VA_ARGS__);
-#define LOG_V3(format, ...)     LOG_F(3,         format, ##__VA_ARGS__);
-#define LOG_V4(format, ...)     LOG_F(4,         format, ##__VA_ARGS__);
-#define LOG_V5(format, ...)     LOG_F(5,         format, ##__VA_ARGS__);
-#define LOG_V6(format, ...)     LOG_F(6,         format, ##__VA_ARGS__);
-#define LOG_V7(format, ...)     LOG_F(7,         format, ##__VA_ARGS__);
-#define LOG_V8(format, ...)     LOG_F(8,         format, ##__VA_ARGS__);
-#define LOG_V9(format, ...)     LOG_F(9,         format, ##__VA_ARGS__);
+//FATAL aborts right away, so it is written synchronously after everything queued before it
+#define LOG_INFO(format, ...)   ASYNC_LOG_F(INFO,    format, ##__VA_ARGS__);
+#define LOG_WARN(format, ...)   ASYNC_LOG_F(WARNING, format, ##__VA_ARGS__);
+#define LOG_ERROR(format, ...)  ASYNC_LOG_F(ERROR,   format, ##__VA_ARGS__);
+#define LOG_FATAL(format, ...)  (async_log::Backend::instance().flush(), LOG_F(FATAL, format, ##__VA_ARGS__));
+#define LOG_DEBUG(format, ...)  ASYNC_LOG_F(1,       format, ##__VA_ARGS__);
+#define LOG_V2(format, ...)     ASYNC_LOG_F(2,       format, ##__VA_ARGS__);
+#define LOG_V3(format, ...)     ASYNC_LOG_F(3,       format, ##__VA_ARGS__);
+#define LOG_V4(format, ...)     ASYNC_LOG_F(4,       format, ##__VA_ARGS__);
+#define LOG_V5(format, ...)     ASYNC_LOG_F(5,       format, ##__VA_ARGS__);
+#define LOG_V6(format, ...)     ASYNC_LOG_F(6,       format, ##__VA_ARGS__);
+#define LOG_V7(format, ...)     ASYNC_LOG_F(7,       format, ##__VA_ARGS__);
+#define LOG_V8(format, ...)     ASYNC_LOG_F(8,       format, ##__VA_ARGS__);
+#define LOG_V9(format, ...)     ASYNC_LOG_F(9,       format, ##__VA_ARGS__);
 
 #else 
 
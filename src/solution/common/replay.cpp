@@ -0,0 +1,267 @@
+#include "replay.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace replay;
+
+static_assert(std::is_trivially_copyable_v<World>, "World is stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<Segment>, "Segment is stored as raw bytes");
+//Every section keeps 8 bytes alignment, so doubles can be read right from mapping
+static_assert(sizeof(file_header_t) % 8 == 0);
+static_assert(sizeof(match_header_t) % 8 == 0);
+static_assert(sizeof(World) % 8 == 0);
+static_assert(sizeof(Segment) % 8 == 0);
+
+namespace {
+
+template<typename T>
+bool write_items(FILE *f, const T *items, size_t count) {
+    return fwrite(items, sizeof(T), count, f) == count;
+}
+
+} // anonymous namespace
+
+//MARK: Writer
+
+Writer::Writer(const char *path)
+    : file_(fopen(path, "wb")) {
+    if (!file_) {
+        LOG_ERROR("Cannot create replay %s", path);
+        return;
+    }
+    file_header_t header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.world_size = sizeof(World);
+    write_items(file_, &header, 1);
+}
+
+Writer::~Writer() {
+    if (file_) {
+        finish_match();
+        fclose(file_);
+    }
+}
+
+bool Writer::ok() const {
+    return file_ != nullptr && !ferror(file_);
+}
+
+void Writer::begin_match(const Game &game) {
+    finish_match();
+
+    const auto &car = game.proto_car;
+    match_header_t header{};
+    header.segment_count = static_cast<uint32_t>(game.proto_map.size());
+    header.body_poly_count = static_cast<uint32_t>(car.body_poly.size());
+    header.button_poly_count = static_cast<uint32_t>(car.button_poly.size());
+    header.lives[0] = game.lives[0];
+    header.lives[1] = game.lives[1];
+    header.proto_map_external_id = game.proto_map_external_id;
+    header.car_external_id = car.external_id;
+    header.drive = car.drive;
+    header.squared_wheels = car.squared_wheels;
+    header.body_elasticity = car.body_elasticity;
+    header.body_friction = car.body_friction;
+    header.body_mass = car.body_mass;
+    header.max_angular_speed = car.max_angular_speed;
+    header.max_speed = car.max_speed;
+    header.torque = car.torque;
+    header.front_wheel = car.front_wheel;
+    header.rear_wheel = car.rear_wheel;
+
+    match_pos_ = ftell(file_);
+    tick_count_ = 0;
+    write_items(file_, &header, 1);
+    write_items(file_, game.proto_map.data(), game.proto_map.size());
+    write_items(file_, car.body_poly.data(), car.body_poly.size());
+    write_items(file_, car.button_poly.data(), car.button_poly.size());
+}
+
+void Writer::add_tick(const World &world) {
+    assert(match_pos_ >= 0);
+    write_items(file_, &world, 1);
+    ++tick_count_;
+}
+
+void Writer::finish_match() {
+    if (match_pos_ < 0) {
+        return;
+    }
+    const long end = ftell(file_);
+    fseek(file_, match_pos_ + static_cast<long>(offsetof(match_header_t, tick_count)), SEEK_SET);
+    write_items(file_, &tick_count_, 1);
+    fseek(file_, end, SEEK_SET);
+    match_pos_ = -1;
+}
+
+//MARK: Reader
+
+Reader::Reader(const char *path) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Cannot open replay %s", path);
+        return;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size_ = static_cast<size_t>(st.st_size);
+        void *mem = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mem != MAP_FAILED) {
+            data_ = static_cast<const uint8_t *>(mem);
+            madvise(mem, size_, MADV_SEQUENTIAL);
+        }
+    }
+    close(fd);
+
+    ok_ = data_ && parse();
+    if (!ok_) {
+        LOG_ERROR("Broken replay %s", path);
+    }
+}
+
+Reader::~Reader() {
+    if (data_) {
+        munmap(const_cast<uint8_t *>(data_), size_);
+    }
+}
+
+bool Reader::ok() const {
+    return ok_;
+}
+
+const std::vector<Reader::match_t> &Reader::matches() const {
+    return matches_;
+}
+
+bool Reader::is_binary(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    char magic[sizeof(MAGIC)];
+    const bool ret = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && !memcmp(magic, MAGIC, sizeof(MAGIC));
+    fclose(f);
+    return ret;
+}
+
+bool Reader::parse() {
+    size_t pos = 0;
+    //Returns pointer to count items at current position, nullptr if file is too short
+    const auto take = [this, &pos](size_t item_size, size_t count) -> const uint8_t * {
+        if (count > (size_ - pos) / item_size) {
+            return nullptr;
+        }
+        const uint8_t *ret = data_ + pos;
+        pos += item_size * count;
+        return ret;
+    };
+
+    const auto *file_header = reinterpret_cast<const file_header_t *>(take(sizeof(file_header_t), 1));
+    if (!file_header || memcmp(file_header->magic, MAGIC, sizeof(MAGIC)) ||
+        file_header->version != VERSION || file_header->world_size != sizeof(World)) {
+        return false;
+    }
+
+    while (pos < size_) {
+        const auto *header = reinterpret_cast<const match_header_t *>(take(sizeof(match_header_t), 1));
+        if (!header) {
+            return false;
+        }
+        const auto *segments = reinterpret_cast<const Segment *>(take(sizeof(Segment), header->segment_count));
+        const auto *body = reinterpret_cast<const vec2 *>(take(sizeof(vec2), header->body_poly_count));
+        const auto *button = reinterpret_cast<const vec2 *>(take(sizeof(vec2), header->button_poly_count));
+        const auto *worlds = reinterpret_cast<const World *>(take(sizeof(World), header->tick_count));
+        if (!segments || !body || !button || !worlds) {
+            return false;
+        }
+
+        match_t match;
+        match.worlds = worlds;
+        match.tick_count = static_cast<int>(header->tick_count);
+
+        Game &game = match.game;
+        game.lives[0] = header->lives[0];
+        game.lives[1] = header->lives[1];
+        game.proto_map.assign(segments, segments + header->segment_count);
+        game.proto_map_external_id = header->proto_map_external_id;
+
+        ProtoCar &car = game.proto_car;
+        car.body_poly.assign(body, body + header->body_poly_count);
+        car.button_poly.assign(button, button + header->button_poly_count);
+        car.drive = static_cast<ProtoCar::DriveType>(header->drive);
+        car.external_id = header->car_external_id;
+        car.body_elasticity = header->body_elasticity;
+        car.body_friction = header->body_friction;
+        car.body_mass = header->body_mass;
+        car.max_angular_speed = header->max_angular_speed;
+        car.max_speed = header->max_speed;
+        car.torque = header->torque;
+        car.squared_wheels = header->squared_wheels != 0;
+        car.front_wheel = header->front_wheel;
+        car.rear_wheel = header->rear_wheel;
+
+        matches_.push_back(std::move(match));
+    }
+    return true;
+}
+
+//MARK: Rounds
+
+bool replay::read_rounds(const char *path, std::vector<round_t> &rounds, int max_ticks) {
+    if (Reader::is_binary(path)) {
+        Reader reader(path);
+        if (!reader.ok()) {
+            return false;
+        }
+        for (const auto &match : reader.matches()) {
+            const int ticks = std::min(match.tick_count, max_ticks);
+            rounds.push_back({path, match.game, {match.worlds, match.worlds + ticks}});
+        }
+        return true;
+    }
+
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    //Ticks before the first new_match are skipped, as strategy does not expect them either
+    const size_t first = rounds.size();
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        const auto j = nlohmann::json::parse(line);
+        const auto type = j["type"].get<std::string>();
+        if (type == "new_match") {
+            rounds.push_back({path, j["params"].get<Game>(), {}});
+        } else if (type == "tick" && rounds.size() > first
+                   && static_cast<int>(rounds.back().worlds.size()) < max_ticks) {
+            rounds.back().worlds.push_back(j["params"].get<World>());
+        }
+    }
+    return true;
+}
+
+bool replay::read_start_positions(const char *path, std::vector<round_t> &positions) {
+    const size_t first = positions.size();
+    if (!read_rounds(path, positions, 1)) {
+        return false;
+    }
+    positions.erase(std::remove_if(positions.begin() + first, positions.end(),
+                                   [](const round_t &round) { return round.worlds.empty(); }),
+                    positions.end());
+    return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "../structures.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+///Binary replay: file header, then every match as match header, its map and car polygons
+///and fixed size World records of all its ticks. Worlds are stored as they are in memory,
+///so reader hands out pointers right into the mapped file.
+namespace replay {
+
+constexpr char MAGIC[8] = {'M', 'C', 'R', 'E', 'P', 'L', 'A', 'Y'};
+constexpr uint32_t VERSION = 1;
+
+struct file_header_t {
+    char magic[8];
+    uint32_t version;
+    ///Replays are only valid for the same World layout
+    uint32_t world_size;
+};
+
+struct match_header_t {
+    uint32_t tick_count;
+    uint32_t segment_count;
+    uint32_t body_poly_count;
+    uint32_t button_poly_count;
+    int32_t lives[2];
+    int32_t proto_map_external_id;
+    int32_t car_external_id;
+    int32_t drive;
+    int32_t squared_wheels;
+    double body_elasticity;
+    double body_friction;
+    double body_mass;
+    double max_angular_speed;
+    double max_speed;
+    double torque;
+    ProtoCar::wheel_t front_wheel;
+    ProtoCar::wheel_t rear_wheel;
+};
+
+///Appends matches to a new replay file, tick count of a match is patched when the next one begins
+class Writer {
+public:
+    explicit Writer(const char *path);
+    ~Writer();
+
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    bool ok() const;
+
+    void begin_match(const Game &game);
+    void add_tick(const World &world);
+
+private:
+    void finish_match();
+
+    FILE *file_;
+    long match_pos_ = -1;
+    uint32_t tick_count_ = 0;
+};
+
+///Read only memory mapping of replay file
+class Reader {
+public:
+    struct match_t {
+        Game game;
+        const World *worlds;
+        int tick_count;
+    };
+
+    explicit Reader(const char *path);
+    ~Reader();
+
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    ///Whether file is mapped and all matches are within it
+    bool ok() const;
+
+    const std::vector<match_t> &matches() const;
+
+    ///Checks file magic, so callers may accept both binary and json replays
+    static bool is_binary(const char *path);
+
+private:
+    bool parse();
+
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+    bool ok_ = false;
+    std::vector<match_t> matches_;
+};
+
+///Round of a json or binary replay
+struct round_t {
+    ///File round was read from, for reports
+    std::string source;
+    Game game;
+    std::vector<World> worlds;
+};
+
+///Appends rounds of replay in either format, at most max_ticks first worlds of each are kept.
+///Json replay is a message per line as latest-game.txt is written, lines are not limited in length.
+///Returns false if file cannot be read
+bool read_rounds(const char *path, std::vector<round_t> &rounds, int max_ticks = std::numeric_limits<int>::max());
+
+///Rounds with their first world only, rounds without ticks are skipped. Offline tools start own play from them
+bool read_start_positions(const char *path, std::vector<round_t> &positions);
+
+} // namespace replay
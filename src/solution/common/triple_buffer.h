@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+///Lock-free handoff of the latest value from one writer thread to one reader thread
+///Writer fills back() and publishes it, reader takes the newest published value and never waits.
+///Values published between two reads are overwritten, so it suits state, not a stream of events
+template <class T>
+class TripleBuffer {
+public:
+    ///Writer side. Slot holds some older value, it should be filled completely
+    T &back() {
+        return slots_[back_];
+    }
+
+    ///Writer side. Make back() visible to reader
+    void publish() {
+        back_ = state_.exchange(static_cast<uint8_t>(back_ | FRESH), std::memory_order_acq_rel) & INDEX;
+    }
+
+    ///Reader side. True if a value was published after the previous update, front() is switched to it
+    bool update() {
+        if (!(state_.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        front_ = state_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    ///Reader side. Default constructed value until the first update
+    const T &front() const {
+        return slots_[front_];
+    }
+
+private:
+    static constexpr uint8_t INDEX = 3;
+    static constexpr uint8_t FRESH = 4;
+
+    T slots_[3];
+    ///Index of the slot between writer and reader and a mark it was not taken by reader yet
+    alignas(64) std::atomic<uint8_t> state_{1};
+    alignas(64) uint8_t back_ = 0;
+    alignas(64) uint8_t front_ = 2;
+};
@@ -1,25 +1,49 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
+///Base seed of all random streams
 extern unsigned int RANDOM_SEED;
 
-inline int fastrand() {
-    //fastrand routine returns one integer, similar output value range as C lib.
-    RANDOM_SEED = 214013 * RANDOM_SEED + 2531011;
-    return (RANDOM_SEED >> 16) & 0x7FFF;
-}
+///Counter based generator: n-th value of a stream is SplitMix64 finalizer of key + n * gamma.
+///Streams share no state, so each search may own one and still replay the same way from the same seed
+class rand_stream_t {
+public:
+    explicit rand_stream_t(uint64_t seed, uint64_t stream = 0)
+        : key_(mix(seed * k_gamma + mix(stream + 1))) {
+    }
+
+    inline uint64_t next() {
+        return mix(key_ + ++counter_ * k_gamma);
+    }
+
+    ///count next values at once, iterations are independent so loop is vectorized
+    inline void fill(uint64_t *out, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = mix(key_ + (counter_ + 1 + i) * k_gamma);
+        }
+        counter_ += count;
+    }
+
+    inline int next_int(int max_size) {
+        return bounded(static_cast<uint32_t>(next() >> 32), max_size);
+    }
 
-inline int rand_int(int max_size) {
-    return fastrand() % max_size;
-}
+    ///Maps 32 random bits to [0, max_size) with multiply and shift instead of modulo
+    static inline int bounded(uint32_t bits, int max_size) {
+        return static_cast<int>((static_cast<uint64_t>(bits) * static_cast<uint32_t>(max_size)) >> 32);
+    }
 
-inline int fast_rand_int(int a, int b) {
-    return (a + rand_int(b - a));
-}
+private:
+    static constexpr uint64_t k_gamma = 0x9E3779B97F4A7C15ull;
 
-inline double fast_rand_double() {
-    return static_cast<double>(fastrand()) / 0x7FFF;
-}
+    static inline uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
 
-inline double fast_rand_double(double a, double b) {
-    return a + (static_cast<double>(fastrand()) / 0x7FFF) * (b - a);
-}
+    uint64_t key_;
+    uint64_t counter_ = 0;
+};
@@ -0,0 +1,128 @@
+#include "latency_watchdog.h"
+#include "../common/logger.h"
+
+#include <algorithm>
+
+namespace {
+
+///Level rises when 95th percentile of window is over this share of search budget
+constexpr double k_degrade_share = 0.6;
+///and falls when it would stay under this share on the previous level, where search takes twice longer
+constexpr double k_restore_share = 0.45;
+///Search over this share of its budget is a near miss, it rises level right away
+constexpr double k_near_miss_share = 0.9;
+///Searches window needs after level change before percentile is trusted, older ones are of another level
+constexpr int k_min_window = LatencyWatchdog::WINDOW / 4;
+constexpr uint32_t k_share_scale = 1000;
+
+[[maybe_unused]] uint32_t percentile(const int *hist, int total, double share) {
+    const int target = static_cast<int>(total * share);
+    int seen = 0;
+    for (int b = 0; b < LatencyWatchdog::BUCKETS; ++b) {
+        seen += hist[b];
+        if (seen > target) {
+            return 1u << b;
+        }
+    }
+    return 1u << (LatencyWatchdog::BUCKETS - 1);
+}
+
+} // anonymous namespace
+
+LatencyWatchdog::LatencyWatchdog(std::chrono::milliseconds game_limit, int game_ticks)
+    : tick_budget_us_(static_cast<uint32_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>(game_limit).count() / game_ticks)) {
+}
+
+void LatencyWatchdog::start_tick(clock::time_point received) {
+    tick_start_ = received;
+}
+
+void LatencyWatchdog::end_tick(int search_period) {
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - tick_start_);
+    const auto latency = static_cast<uint32_t>(std::max<int64_t>(0, elapsed.count()));
+
+    ++match_.ticks;
+    ++match_.hist[bucket(latency)];
+    ++match_.ticks_on_level[level_];
+    match_.max_us = std::max(match_.max_us, latency);
+    match_.total_us += latency;
+
+    //Ticks without search are cheap, they only leave more time to searches of the game
+    if (search_period > 0) {
+        ++match_.searches;
+        const uint64_t budget_us = static_cast<uint64_t>(tick_budget_us_) * search_period;
+        const auto share = static_cast<uint32_t>(std::min<uint64_t>(
+            latency * static_cast<uint64_t>(k_share_scale) / budget_us, UINT32_MAX));
+
+        window_size_ = std::min(window_size_ + 1, WINDOW);
+        window_[window_pos_] = share;
+        window_pos_ = (window_pos_ + 1) % WINDOW;
+
+        update_level(share);
+    }
+}
+
+void LatencyWatchdog::report_match() {
+    if (match_.ticks > 0) {
+        LOG_INFO("Latency: %d ticks, mean %.2f ms, p50 < %.2f ms, p95 < %.2f ms, p99 < %.2f ms, max %.2f ms",
+                 match_.ticks, match_.total_us / 1000.0 / match_.ticks,
+                 percentile(match_.hist, match_.ticks, 0.5) / 1000.0,
+                 percentile(match_.hist, match_.ticks, 0.95) / 1000.0,
+                 percentile(match_.hist, match_.ticks, 0.99) / 1000.0, match_.max_us / 1000.0);
+        LOG_INFO("Latency: %d searches, %d near misses of %.2f ms per tick budget, %d level changes, "
+                 "ticks on levels %d/%d/%d/%d",
+                 match_.searches, match_.near_misses, tick_budget_us_ / 1000.0, match_.level_changes,
+                 match_.ticks_on_level[0],
+                 match_.ticks_on_level[1], match_.ticks_on_level[2], match_.ticks_on_level[3]);
+        if (match_.near_misses > 0) {
+            LOG_WARN("Latency: %d searches were close to their share of game time", match_.near_misses);
+        }
+    }
+    match_ = match_t{};
+}
+
+void LatencyWatchdog::update_level(uint32_t share) {
+    if (share > k_near_miss_share * k_share_scale) {
+        ++match_.near_misses;
+        set_level(std::min(level_ + 1, MAX_LEVEL), share);
+        return;
+    }
+    if (window_size_ < k_min_window) {
+        return;
+    }
+
+    const uint32_t p95 = window_percentile(0.95);
+    if (p95 > k_degrade_share * k_share_scale) {
+        set_level(std::min(level_ + 1, MAX_LEVEL), share);
+    } else if (level_ > 0 && 2 * p95 < k_restore_share * k_share_scale) {
+        set_level(level_ - 1, share);
+    }
+}
+
+void LatencyWatchdog::set_level(int level, [[maybe_unused]] uint32_t share) {
+    if (level == level_) {
+        return;
+    }
+    ++match_.level_changes;
+    LOG_DEBUG("Search took %.1f%% of budget, search level %d -> %d", share * 100.0 / k_share_scale, level_, level);
+    level_ = level;
+    window_size_ = 0;
+    window_pos_ = 0;
+}
+
+uint32_t LatencyWatchdog::window_percentile(double share) const {
+    uint32_t sorted[WINDOW];
+    std::copy(window_, window_ + window_size_, sorted);
+    const int idx = std::min(static_cast<int>(window_size_ * share), window_size_ - 1);
+    std::nth_element(sorted, sorted + idx, sorted + window_size_);
+    return sorted[idx];
+}
+
+int LatencyWatchdog::bucket(uint32_t us) {
+    int ret = 0;
+    while (ret < BUCKETS - 1 && (1u << ret) < us) {
+        ++ret;
+    }
+    return ret;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+///Latency of search ticks over a rolling window and search degradation level derived from it. Server limits
+///total time of the game, so every search is judged against its share of that time: the ticks it covers times
+///the average tick budget. Level rises when latency approaches the budget and falls back when search of the
+///previous level would fit again, so one slow stretch of ticks (long resimulation, OS jitter) does not end in
+///a timeout. Latency is measured from the moment input is received, so json parsing counts
+class LatencyWatchdog {
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr int WINDOW = 128;
+    static constexpr int MAX_LEVEL = 3;
+    ///Log2 buckets of microseconds for match statistics
+    static constexpr int BUCKETS = 24;
+
+    ///Game limit is the time of the whole game, spread evenly over its max ticks
+    LatencyWatchdog(std::chrono::milliseconds game_limit, int game_ticks);
+
+    void start_tick(clock::time_point received);
+
+    ///Search period is the count of ticks search of this tick plans for, 0 when there was no search
+    void end_tick(int search_period = 0);
+
+    ///Share of the full search budget to spend, halved on every level
+    double budget_factor() const {
+        return 1.0 / (1 << level_);
+    }
+
+    int level() const {
+        return level_;
+    }
+
+    ///Logs statistics of the match and starts a new one, window and level are kept
+    void report_match();
+
+private:
+    ///Share is search latency in thousandths of its budget
+    void update_level(uint32_t share);
+
+    void set_level(int level, uint32_t share);
+
+    ///Latency share of window searches are within, in thousandths of search budget
+    uint32_t window_percentile(double share) const;
+
+    static int bucket(uint32_t us);
+
+    ///Average share of game time of one tick
+    const uint32_t tick_budget_us_;
+
+    clock::time_point tick_start_;
+
+    ///Search latencies in thousandths of their budgets, so searches of different periods compare
+    uint32_t window_[WINDOW] = {};
+    int window_size_ = 0;
+    int window_pos_ = 0;
+
+    int level_ = 0;
+
+    struct match_t {
+        int ticks = 0;
+        int searches = 0;
+        int near_misses = 0;
+        int level_changes = 0;
+        uint32_t max_us = 0;
+        uint64_t total_us = 0;
+        int hist[BUCKETS] = {};
+        int ticks_on_level[MAX_LEVEL + 1] = {};
+    } match_;
+};
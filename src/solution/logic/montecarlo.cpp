@@ -5,11 +5,24 @@
 #include "montecarlo.h"
 #include "fastrand.h"
 #include "evaluator.h"
+#include "search_trace.h"
+#include "../common/triple_buffer.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <utility>
 
 namespace montecarlo {
 
-Genome::Genome(const Evaluator *evaluator, bool with_random) {
+template <uint8_t Depth, uint8_t TurnLen>
+GenomeT<Depth, TurnLen>::GenomeT(const Evaluator *evaluator, rand_stream_t *rng, bool with_random) {
     evaluator_ = evaluator;
+    rng_ = rng;
     scored_ = false;
 
     if (with_random) {
@@ -21,13 +34,15 @@ Genome::Genome(const Evaluator *evaluator, bool with_random) {
     }
 }
 
-void Genome::duplicate(Genome &other) {
+template <uint8_t Depth, uint8_t TurnLen>
+void GenomeT<Depth, TurnLen>::duplicate(GenomeT &other) {
     memcpy(other.actions_, actions_, DEPTH * sizeof(actions_[0]));
     other.score_ = score_;
     other.scored_ = scored_;
 }
 
-void Genome::shift() {
+template <uint8_t Depth, uint8_t TurnLen>
+void GenomeT<Depth, TurnLen>::shift() {
     ++small_shift_;
     if (small_shift_ == TURN_LEN) {
         for (size_t i = 1; i < DEPTH; ++i) {
@@ -39,47 +54,71 @@ void Genome::shift() {
     scored_ = false;
 }
 
-void Genome::mutate() {
-    randomize(rand_int(DEPTH));
+template <uint8_t Depth, uint8_t TurnLen>
+uint32_t GenomeT<Depth, TurnLen>::mutate(int times) {
+    static_assert(DEPTH <= 32, "Mutated positions are returned as bits");
+    assert(times <= DEPTH);
+    //Position in high half of each draw, action in low one
+    uint64_t bits[DEPTH];
+    rng_->fill(bits, static_cast<size_t>(times));
+    uint32_t ret = 0;
+    for (int i = 0; i < times; ++i) {
+        const int idx = rand_stream_t::bounded(static_cast<uint32_t>(bits[i] >> 32), DEPTH);
+        actions_[idx] = static_cast<Action>(rand_stream_t::bounded(static_cast<uint32_t>(bits[i]), 3));
+        ret |= 1u << idx;
+    }
+    return ret;
 }
 
-void Genome::mutate(Genome *other) const {
+template <uint8_t Depth, uint8_t TurnLen>
+uint32_t GenomeT<Depth, TurnLen>::mutate(GenomeT *other, int times) const {
     memcpy(other->actions_, actions_, DEPTH * sizeof(actions_[0]));
-    other->mutate();
+    other->small_shift_ = small_shift_;
     other->scored_ = false;
+    return other->mutate(times);
 }
 
-double Genome::get_score(Simulator &sim, cp::transaction_t &mut_buffer, const Genome &enemy) {
-    static const auto k_attenuation = [] {
-        std::vector<double> ret;
-        ret.reserve(DEPTH);
-        double val = 1.0;
-        for (int i = 1; i <= DEPTH * TURN_LEN; ++i) {
-            val *= 0.98;
-            if (i % TURN_LEN == 0) {
-                ret.push_back(val);
-            }
+template <uint8_t Depth, uint8_t TurnLen>
+void GenomeT<Depth, TurnLen>::crossover(const GenomeT &other, GenomeT *child) const {
+    const int cut = 1 + rng_->next_int(DEPTH - 1);
+    memcpy(child->actions_, actions_, cut * sizeof(actions_[0]));
+    memcpy(child->actions_ + cut, other.actions_ + cut, (DEPTH - cut) * sizeof(actions_[0]));
+    child->small_shift_ = small_shift_;
+    child->scored_ = false;
+}
+
+namespace {
+
+template <uint8_t Depth, uint8_t TurnLen>
+const std::array<double, Depth> k_attenuation = [] {
+    std::array<double, Depth> ret{};
+    double val = 1.0;
+    for (int i = 1; i <= Depth * TurnLen; ++i) {
+        val *= 0.98;
+        if (i % TurnLen == 0) {
+            ret[i / TurnLen - 1] = val;
         }
-        return ret;
-    }();
+    }
+    return ret;
+}();
 
+} // anonymous namespace
+
+template <uint8_t Depth, uint8_t TurnLen>
+double GenomeT<Depth, TurnLen>::get_score(Simulator &sim, cp::transaction_t &mut_buffer, const GenomeT &enemy) {
     if (!scored_) {
         scored_ = true;
         score_ = 0.0;
-        for (int i = small_shift_; i < TURN_LEN; ++i) {
+        //Rollout stops on the very step somebody lost
+        for (int i = small_shift_; i < TURN_LEN && !sim.round_over(); ++i) {
             sim.step(actions_[0], enemy.actions_[0]);
         }
-        score_ += k_attenuation[0] * evaluator_->eval(sim.world_native());
-        if (!sim.world_native().cars[0].loosed && !sim.world_native().cars[1].loosed) {
-            for (size_t act_idx = 1; act_idx < DEPTH; ++act_idx) {
-                for (int i = 0; i < TURN_LEN; ++i) {
-                    sim.step(actions_[act_idx], enemy.actions_[act_idx]);
-                }
-                score_ += k_attenuation[act_idx] * evaluator_->eval(sim.world_native());
-                if (sim.world_native().cars[0].loosed || sim.world_native().cars[1].loosed) {
-                    break;
-                }
+        score_ += k_attenuation<Depth, TurnLen>[0] * evaluator_->eval(sim.world_native());
+        for (size_t act_idx = 1; act_idx < DEPTH && !sim.round_over(); ++act_idx) {
+            for (int i = 0; i < TURN_LEN && !sim.round_over(); ++i) {
+                sim.step(actions_[act_idx], enemy.actions_[act_idx]);
             }
+            score_ += k_attenuation<Depth, TurnLen>[act_idx] * evaluator_->eval(sim.world_native());
         }
         //Restore world
         sim.restore(mut_buffer);
@@ -87,19 +126,733 @@ double Genome::get_score(Simulator &sim, cp::transaction_t &mut_buffer, const Ge
     return score_;
 }
 
-Action Genome::get_action() const {
+template <uint8_t Depth, uint8_t TurnLen>
+Action GenomeT<Depth, TurnLen>::get_action() const {
     return actions_[0];
 }
 
-void Genome::randomize() {
+template <uint8_t Depth, uint8_t TurnLen>
+void GenomeT<Depth, TurnLen>::randomize() {
+    uint64_t bits[DEPTH];
+    rng_->fill(bits, DEPTH);
     for (int i = 0; i < DEPTH; ++i) {
-        randomize(i);
+        actions_[i] = static_cast<Action>(rand_stream_t::bounded(static_cast<uint32_t>(bits[i] >> 32), 3));
+    }
+}
+
+template <uint8_t Depth, uint8_t TurnLen>
+void GenomeT<Depth, TurnLen>::randomize(int sample_depth) {
+    actions_[sample_depth] = static_cast<Action>(rng_->next_int(3));
+}
+
+//MARK: BatchScorer
+
+template <class G>
+void BatchScorer<G>::reset(Simulator &sim, cp::transaction_t &origin, const G &enemy) {
+    sim_ = &sim;
+    origin_ = &origin;
+    enemy_ = &enemy;
+    ref_levels_ = 0;
+}
+
+template <class G>
+double BatchScorer<G>::score(G &genome) {
+    if (genome.scored_) {
+        simulated_levels_ = 0;
+        return genome.score_;
+    }
+
+    //Continue from last level shared with reference rollout
+    const int prefix = common_prefix(genome);
+    double score = 0.0;
+    bool finished = false;
+    if (prefix > 0) {
+        score = ref_[prefix - 1].score;
+        finished = ref_[prefix - 1].finished;
+    }
+
+    int levels = prefix;
+    if (!finished && levels < G::DEPTH) {
+        if (prefix > 0) {
+            sim_->restore(ref_[prefix - 1].dump);
+        }
+        for (int act_idx = prefix; act_idx < G::DEPTH && !finished; ++act_idx) {
+            for (int i = act_idx == 0 ? genome.small_shift_ : 0; i < G::TURN_LEN && !finished; ++i) {
+                sim_->step(genome.actions_[act_idx], enemy_->actions_[act_idx]);
+                finished = sim_->round_over();
+            }
+            score += k_attenuation<G::DEPTH, G::TURN_LEN>[act_idx] * genome.evaluator_->eval(sim_->world_native());
+
+            auto &level = last_[act_idx];
+            sim_->save(level.dump);
+            level.score = score;
+            level.finished = finished;
+            ++levels;
+        }
+        sim_->restore(*origin_);
+    }
+
+    genome.scored_ = true;
+    genome.score_ = score;
+    simulated_levels_ = levels - prefix;
+
+    //Best rollout becomes new reference path
+    if (ref_levels_ == 0 || score > ref_score_) {
+        for (int i = prefix; i < levels; ++i) {
+            std::swap(ref_[i], last_[i]);
+        }
+        memcpy(ref_actions_, genome.actions_, G::DEPTH * sizeof(genome.actions_[0]));
+        ref_shift_ = genome.small_shift_;
+        ref_levels_ = levels;
+        ref_score_ = score;
+    }
+
+    return score;
+}
+
+template <class G>
+void BatchScorer<G>::score(G *genomes, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        score(genomes[i]);
+    }
+}
+
+template <class G>
+int BatchScorer<G>::common_prefix(const G &genome) const {
+    if (genome.small_shift_ != ref_shift_) {
+        return 0;
+    }
+    int ret = 0;
+    while (ret < ref_levels_ && genome.actions_[ret] == ref_actions_[ret]) {
+        ++ret;
+    }
+    return ret;
+}
+
+//MARK: Search
+
+template <class G>
+void hill_climb(G *solution, BatchScorer<G> &scorer, int count, bool shake) {
+    G child(solution->evaluator_, solution->rng_, false);
+    SEARCH_TRACE(begin_climb(G::DEPTH, G::TURN_LEN, shake, count))
+    for (int cnt = 0; cnt < count; ++cnt) {
+        int times = 1;
+        if (shake) {
+            if (cnt < count / 5) {
+                times += 2;
+            } else if (cnt < count * 3 / 5) {
+                times += 1;
+            }
+        }
+        [[maybe_unused]] const uint32_t positions = solution->mutate(&child, times);
+
+        const double parent_score = scorer.score(*solution);
+        const double child_score = scorer.score(child);
+        SEARCH_TRACE(add_mutation({static_cast<uint16_t>(cnt), static_cast<search_trace::phase_t>(3 - times),
+                                   child_score > parent_score, positions,
+                                   static_cast<float>(parent_score), static_cast<float>(child_score),
+                                   static_cast<uint8_t>(scorer.simulated_levels()), {}}))
+        if (child_score > parent_score) {
+            child.duplicate(*solution);
+        }
+    }
+    SEARCH_TRACE(end_climb())
+}
+
+template <class G>
+Population<G>::Population(const Evaluator *evaluator, rand_stream_t *rng)
+    : rng_(rng) {
+    generation_.reserve(SIZE);
+    next_.reserve(SIZE);
+    for (int i = 0; i < SIZE; ++i) {
+        generation_.emplace_back(evaluator, rng, true);
+        next_.emplace_back(evaluator, rng, false);
     }
 }
 
-void Genome::randomize(int sample_depth) {
-    actions_[sample_depth] = static_cast<Action>(rand_int(3));
+template <class G>
+void Population<G>::shift() {
+    for (auto &genome : generation_) {
+        genome.shift();
+    }
+}
+
+template <class G>
+void Population<G>::evolve(G *solution, BatchScorer<G> &scorer, int count) {
+    //Solution replaces the worst genome left from previous search
+    solution->duplicate(generation_[SIZE - 1]);
+    generation_[SIZE - 1].small_shift_ = solution->small_shift_;
+
+    const auto by_score = [](const G &a, const G &b) {
+        return a.score_ > b.score_;
+    };
+
+    //Survivors keep their scores, so the first generation costs only its new genomes
+    scorer.score(generation_.data(), SIZE);
+    std::sort(generation_.begin(), generation_.end(), by_score);
+    for (int scored = SIZE - ELITE; scored < count; scored += SIZE - ELITE) {
+        for (int i = 0; i < ELITE; ++i) {
+            generation_[i].duplicate(next_[i]);
+            next_[i].small_shift_ = generation_[i].small_shift_;
+        }
+        for (int i = ELITE; i < SIZE; ++i) {
+            generation_[tournament()].crossover(generation_[tournament()], &next_[i]);
+            next_[i].mutate();
+        }
+        scorer.score(next_.data() + ELITE, SIZE - ELITE);
+        std::swap(generation_, next_);
+        std::sort(generation_.begin(), generation_.end(), by_score);
+    }
+
+    generation_[0].duplicate(*solution);
+}
+
+template <class G>
+int Population<G>::tournament() const {
+    int ret = rng_->next_int(SIZE);
+    for (int i = 1; i < TOURNAMENT; ++i) {
+        const int idx = rng_->next_int(SIZE);
+        if (generation_[idx].score_ > generation_[ret].score_) {
+            ret = idx;
+        }
+    }
+    return ret;
+}
+
+//MARK: Tree search
+
+namespace {
+
+constexpr Action k_actions[] = {Action::LEFT, Action::RIGHT, Action::STOP};
+///UCB exploration, relative to the range of returns seen
+constexpr double k_exploration = 0.5;
+
+} // anonymous namespace
+
+template <class G>
+TreeSearch<G>::TreeSearch(const Evaluator *evaluator, rand_stream_t *rng)
+    : evaluator_(evaluator)
+    , rng_(rng)
+    , nodes_(MAX_NODES) {
+    free_.reserve(MAX_NODES);
+    for (int i = MAX_NODES - 1; i >= 0; --i) {
+        free_.push_back(i);
+    }
+    root_ = alloc_node();
+}
+
+template <class G>
+void TreeSearch<G>::shift() {
+    ++small_shift_;
+    if (small_shift_ < G::TURN_LEN) {
+        return;
+    }
+    small_shift_ = 0;
+
+    //Subtree of the taken action becomes the root, the rest is dropped
+    node_t &root = nodes_[root_];
+    const int next = root.children[static_cast<int>(committed_)];
+    root.children[static_cast<int>(committed_)] = -1;
+    release(root_);
+    root_ = next >= 0 ? next : alloc_node();
+    current_ = -1;
+}
+
+template <class G>
+void TreeSearch<G>::search(G *solution, Simulator &sim, cp::transaction_t &origin, const G &enemy, int count) {
+    sim_ = &sim;
+    ++generation_;
+    current_ = root_;
+    min_return_ = INF;
+    max_return_ = -INF;
+    nodes_[root_].finished = sim.round_over();
+
+    constexpr double gamma = k_attenuation<G::DEPTH, G::TURN_LEN>[1] / k_attenuation<G::DEPTH, G::TURN_LEN>[0];
+    int path[G::DEPTH + 1];
+    double evals[G::DEPTH + 1];
+    for (int it = 0; it < count; ++it) {
+        //Selection and expansion
+        path[0] = root_;
+        int depth = 0;
+        bool expanded = false;
+        while (depth < G::DEPTH && !expanded && !nodes_[path[depth]].finished) {
+            const int parent = path[depth];
+            const int action = select(parent);
+            if (action < 0) {
+                break;
+            }
+            const int child = nodes_[parent].children[action];
+            expanded = nodes_[child].visits == 0;
+            enter(parent, child, k_actions[action], depth, origin, enemy);
+            path[++depth] = child;
+            evals[depth] = nodes_[child].eval;
+        }
+
+        //Rollout by random actions up to the horizon
+        const int leaf = path[depth];
+        if (current_ != leaf) {
+            sim.restore(leaf == root_ ? origin : nodes_[leaf].state);
+            current_ = leaf;
+        }
+        bool finished = nodes_[leaf].finished;
+        int levels = depth;
+        for (int level = depth; level < G::DEPTH && !finished; ++level) {
+            const Action action = k_actions[rng_->next_int(3)];
+            for (int i = 0; i < level_ticks(level) && !finished; ++i) {
+                sim.step(action, enemy.actions_[level]);
+                finished = sim.round_over();
+            }
+            evals[++levels] = evaluator_->eval(sim.world_native());
+            current_ = -1;
+        }
+
+        //Backpropagation, return of a node is discounted from its level
+        double ret = 0.0;
+        for (int level = levels; level > 0; --level) {
+            ret = evals[level] + gamma * ret;
+            if (level <= depth) {
+                node_t &node = nodes_[path[level]];
+                ++node.visits;
+                node.value_sum += ret;
+            }
+        }
+        ++nodes_[root_].visits;
+        min_return_ = std::min(min_return_, ret);
+        max_return_ = std::max(max_return_, ret);
+    }
+    sim.restore(origin);
+    current_ = root_;
+
+    //Most visited path is the plan, the rest of solution is kept
+    int node = root_;
+    for (int level = 0; level < G::DEPTH; ++level) {
+        int best = -1;
+        for (int a = 0; a < 3; ++a) {
+            const int child = nodes_[node].children[a];
+            if (child >= 0 && (best < 0 || nodes_[child].visits > nodes_[nodes_[node].children[best]].visits)) {
+                best = a;
+            }
+        }
+        if (best < 0 || nodes_[nodes_[node].children[best]].visits == 0) {
+            break;
+        }
+        solution->actions_[level] = k_actions[best];
+        if (level == 0) {
+            committed_ = k_actions[best];
+        }
+        node = nodes_[node].children[best];
+    }
+    solution->scored_ = false;
+}
+
+template <class G>
+int TreeSearch<G>::alloc_node() {
+    if (free_.empty()) {
+        return -1;
+    }
+    const int idx = free_.back();
+    free_.pop_back();
+    node_t &node = nodes_[idx];
+    std::fill(std::begin(node.children), std::end(node.children), -1);
+    node.visits = 0;
+    node.value_sum = 0.0;
+    node.eval = 0.0;
+    node.finished = false;
+    node.generation = 0;
+    return idx;
+}
+
+template <class G>
+void TreeSearch<G>::release(int idx) {
+    for (int child : nodes_[idx].children) {
+        if (child >= 0) {
+            release(child);
+        }
+    }
+    free_.push_back(idx);
+}
+
+template <class G>
+int TreeSearch<G>::select(int idx) {
+    node_t &node = nodes_[idx];
+    //Unvisited actions first, in random order so neither is preferred
+    const int first = rng_->next_int(3);
+    for (int i = 0; i < 3; ++i) {
+        const int action = (first + i) % 3;
+        if (node.children[action] < 0) {
+            node.children[action] = alloc_node();
+        }
+        if (node.children[action] >= 0 && nodes_[node.children[action]].visits == 0) {
+            return action;
+        }
+    }
+
+    const double range = max_return_ > min_return_ ? max_return_ - min_return_ : 1.0;
+    const double log_visits = std::log(static_cast<double>(node.visits));
+    int ret = -1;
+    double best = -INF;
+    for (int action = 0; action < 3; ++action) {
+        if (node.children[action] < 0) {
+            continue;
+        }
+        const node_t &child = nodes_[node.children[action]];
+        const double ucb = child.value_sum / child.visits
+                           + k_exploration * range * std::sqrt(log_visits / child.visits);
+        if (ucb > best) {
+            best = ucb;
+            ret = action;
+        }
+    }
+    return ret;
+}
+
+template <class G>
+void TreeSearch<G>::enter(int parent, int child, Action action, int level,
+                          cp::transaction_t &origin, const G &enemy) {
+    node_t &node = nodes_[child];
+    if (node.generation == generation_) {
+        if (current_ != child) {
+            sim_->restore(node.state);
+            current_ = child;
+        }
+        return;
+    }
+
+    if (current_ != parent) {
+        sim_->restore(parent == root_ ? origin : nodes_[parent].state);
+    }
+    bool finished = false;
+    for (int i = 0; i < level_ticks(level) && !finished; ++i) {
+        sim_->step(action, enemy.actions_[level]);
+        finished = sim_->round_over();
+    }
+    node.eval = evaluator_->eval(sim_->world_native());
+    node.finished = finished;
+    node.generation = generation_;
+    sim_->save(node.state);
+    current_ = child;
+}
+
+template <class G>
+int TreeSearch<G>::level_ticks(int level) const {
+    return level == 0 ? G::TURN_LEN - small_shift_ : G::TURN_LEN;
+}
+
+//MARK: Planner
+
+namespace {
+
+///My side of search with engine chosen for planner
+template <class G>
+class SolutionSearch {
+public:
+    SolutionSearch(Engine engine, const Evaluator *evaluator, rand_stream_t *rng) {
+        if (engine == Engine::EVOLUTION) {
+            population_.emplace(evaluator, rng);
+        } else if (engine == Engine::TREE) {
+            tree_.emplace(evaluator, rng);
+        }
+    }
+
+    void shift() {
+        if (population_) {
+            population_->shift();
+        }
+        if (tree_) {
+            tree_->shift();
+        }
+    }
+
+    ///Scorer should be reset to origin and enemy
+    void search(G *solution, Simulator &sim, cp::transaction_t &origin, const G &enemy,
+                BatchScorer<G> &scorer, int count) {
+        if (population_) {
+            population_->evolve(solution, scorer, count);
+        } else if (tree_) {
+            tree_->search(solution, sim, origin, enemy, count);
+        } else {
+            hill_climb(solution, scorer, count, true);
+        }
+    }
+
+private:
+    std::optional<Population<G>> population_;
+    std::optional<TreeSearch<G>> tree_;
+};
+
+template <class G>
+class PlannerT : public Planner {
+public:
+    PlannerT(Engine engine, const Evaluator *evaluator, rand_stream_t *my_rng, rand_stream_t *enemy_rng)
+        : solution_(evaluator, my_rng, true)
+        , enemy_solution_(evaluator, enemy_rng, true)
+        , search_(engine, evaluator, my_rng) {
+    }
+
+    int turn_len() const override {
+        return G::TURN_LEN;
+    }
+
+    void shift() override {
+        solution_.shift();
+        enemy_solution_.shift();
+        search_.shift();
+    }
+
+    void search(Simulator &sim, cp::transaction_t &origin,
+                [[maybe_unused]] const std::vector<Action> &my_actions, const std::vector<Action> &,
+                int enemy_mutations, int my_mutations) override {
+        SEARCH_TRACE(set_context(static_cast<int>(my_actions.size()), search_trace::side_t::ENEMY))
+        sim.swap_sides();
+        scorer_.reset(sim, origin, solution_);
+        hill_climb(&enemy_solution_, scorer_, enemy_mutations, false);
+        sim.swap_sides(); //Return me back
+
+        SEARCH_TRACE(set_context(static_cast<int>(my_actions.size()), search_trace::side_t::ME))
+        scorer_.reset(sim, origin, enemy_solution_);
+        search_.search(&solution_, sim, origin, enemy_solution_, scorer_, my_mutations);
+    }
+
+    Action action() const override {
+        return solution_.get_action();
+    }
+
+private:
+    G solution_;
+    G enemy_solution_;
+    SolutionSearch<G> search_;
+    BatchScorer<G> scorer_;
+};
+
+//MARK: Pipelined planner
+
+///States kept by RoundFollower to replay corrected actions, strategy corrects two ticks back
+constexpr size_t k_follower_history = 8;
+///Enemy model publishes its solution after every chunk of mutations
+constexpr int k_enemy_chunk = 5;
+///Enemy model waits for the next origin after this many times enemy mutations requested for the search
+constexpr int k_enemy_mutations_scale = 20;
+constexpr auto k_enemy_idle = std::chrono::microseconds(100);
+
+///Own simulator brought to the state search origin of strategy is in, by replaying actions of the round
+///Arena snapshots can't be passed between threads, while replay is bit exact
+class RoundFollower {
+public:
+    RoundFollower(const Game *game, const World &start)
+        : game_(game)
+        , start_(start) {
+        reset();
+    }
+
+    Simulator &sim() {
+        return sim_;
+    }
+
+    ///Actions of both cars on every tick from the round start
+    void follow(const std::vector<Action> &my_actions, const std::vector<Action> &enemy_actions) {
+        assert(my_actions.size() == enemy_actions.size());
+        //Strategy replaces enemy actions of recent ticks, once their effect is seen
+        const size_t applied = my_actions_.size();
+        size_t same = 0;
+        while (same < applied && same < my_actions.size()
+               && my_actions_[same] == my_actions[same] && enemy_actions_[same] == enemy_actions[same]) {
+            ++same;
+        }
+        if (same < applied) {
+            if (applied - same > k_follower_history) {
+                reset();
+            } else {
+                sim_.restore(states_[same % k_follower_history]);
+                my_actions_.resize(same);
+                enemy_actions_.resize(same);
+            }
+        }
+
+        for (size_t t = my_actions_.size(); t < my_actions.size(); ++t) {
+            sim_.save(states_[t % k_follower_history]);
+            sim_.step(my_actions[t], enemy_actions[t]);
+            my_actions_.push_back(my_actions[t]);
+            enemy_actions_.push_back(enemy_actions[t]);
+        }
+    }
+
+private:
+    void reset() {
+        sim_.init(game_);
+        sim_.set_world(start_);
+        my_actions_.clear();
+        enemy_actions_.clear();
+    }
+
+    const Game *game_;
+    const World start_;
+    Simulator sim_;
+    ///Actions simulator state was reached by
+    std::vector<Action> my_actions_;
+    std::vector<Action> enemy_actions_;
+    ///State before step of tick t is in states_[t % k_follower_history]
+    cp::transaction_t states_[k_follower_history];
+};
+
+template <class G>
+class PipelinedPlannerT : public Planner {
+public:
+    PipelinedPlannerT(Engine engine, const Evaluator *evaluator, const Game *game, const World &start,
+                      rand_stream_t *my_rng, rand_stream_t *enemy_rng)
+        : solution_(evaluator, my_rng, true)
+        , enemy_solution_(evaluator, &shift_rng_, true)
+        , search_(engine, evaluator, my_rng)
+        , enemy_model_(&PipelinedPlannerT::enemy_model, this, evaluator, game, start, enemy_rng) {
+    }
+
+    ~PipelinedPlannerT() override {
+        stop_.store(true, std::memory_order_relaxed);
+        enemy_model_.join();
+    }
+
+    int turn_len() const override {
+        return G::TURN_LEN;
+    }
+
+    void shift() override {
+        solution_.shift();
+        enemy_solution_.shift();
+        search_.shift();
+    }
+
+    void search(Simulator &sim, cp::transaction_t &origin,
+                const std::vector<Action> &my_actions, const std::vector<Action> &enemy_actions,
+                int enemy_mutations, int my_mutations) override {
+        const int turn = static_cast<int>(my_actions.size());
+
+        //Enemy model publishes solutions for some earlier origin, it is shifted to this one
+        if (enemies_.update()) {
+            const auto &enemy = enemies_.front();
+            memcpy(enemy_solution_.actions_, enemy.actions, G::DEPTH * sizeof(enemy.actions[0]));
+            enemy_solution_.small_shift_ = enemy.small_shift;
+            for (int t = enemy.turn; t < turn; ++t) {
+                enemy_solution_.shift();
+            }
+        }
+
+        SEARCH_TRACE(set_context(turn, search_trace::side_t::ME))
+        scorer_.reset(sim, origin, enemy_solution_);
+        search_.search(&solution_, sim, origin, enemy_solution_, scorer_, my_mutations);
+
+        //Enemy model searches against my improved solution until the next origin
+        auto &pos = positions_.back();
+        pos.turn = turn;
+        pos.max_mutations = enemy_mutations * k_enemy_mutations_scale;
+        pos.my_actions = my_actions;
+        pos.enemy_actions = enemy_actions;
+        memcpy(pos.solution, solution_.actions_, G::DEPTH * sizeof(pos.solution[0]));
+        positions_.publish();
+    }
+
+    Action action() const override {
+        return solution_.get_action();
+    }
+
+private:
+    ///Search origin for enemy model
+    struct position_t {
+        int turn = -1;
+        ///Budget of enemy model for this origin, so strategy cuts of search budget apply to it too
+        int max_mutations = 0;
+        std::vector<Action> my_actions;
+        std::vector<Action> enemy_actions;
+        ///My solution enemy one is searched against
+        Action solution[G::DEPTH];
+    };
+
+    ///The best enemy solution for origin of turn
+    struct enemy_t {
+        int turn = -1;
+        Action actions[G::DEPTH];
+        int small_shift = 0;
+    };
+
+    ///Thread body. Simulator and snapshots are in arena of this thread, so all of them are created here
+    void enemy_model(const Evaluator *evaluator, const Game *game, const World &start, rand_stream_t *rng) {
+        RoundFollower follower(game, start);
+        Simulator &sim = follower.sim();
+        cp::transaction_t origin;
+        BatchScorer<G> scorer;
+        G enemy(evaluator, rng, true);
+        G mine(evaluator, rng, false);
+        int turn = -1;
+        int climbed = 0;
+        int max_mutations = 0;
+
+        while (!stop_.load(std::memory_order_relaxed)) {
+            if (positions_.update()) {
+                const auto &pos = positions_.front();
+                follower.follow(pos.my_actions, pos.enemy_actions);
+                sim.save(origin);
+                if (turn >= 0) {
+                    //Beyond the horizon all actions are random anyway
+                    const int shifts = std::min(pos.turn - turn, G::DEPTH * G::TURN_LEN);
+                    for (int i = 0; i < shifts; ++i) {
+                        enemy.shift();
+                    }
+                }
+                enemy.scored_ = false;
+                memcpy(mine.actions_, pos.solution, G::DEPTH * sizeof(pos.solution[0]));
+                scorer.reset(sim, origin, mine);
+                turn = pos.turn;
+                max_mutations = pos.max_mutations;
+                SEARCH_TRACE(set_context(turn, search_trace::side_t::ENEMY))
+                climbed = 0;
+            } else if (turn < 0 || climbed >= max_mutations) {
+                std::this_thread::sleep_for(k_enemy_idle);
+                continue;
+            }
+
+            sim.swap_sides();
+            hill_climb(&enemy, scorer, k_enemy_chunk, false);
+            sim.swap_sides(); //Return me back
+            climbed += k_enemy_chunk;
+
+            auto &out = enemies_.back();
+            out.turn = turn;
+            memcpy(out.actions, enemy.actions_, G::DEPTH * sizeof(out.actions[0]));
+            out.small_shift = enemy.small_shift_;
+            enemies_.publish();
+        }
+    }
+
+    ///Shifts enemy solution on this thread, enemy stream belongs to enemy model
+    rand_stream_t shift_rng_{RANDOM_SEED, 2};
+    G solution_;
+    ///Latest enemy solution taken from enemy model
+    G enemy_solution_;
+    SolutionSearch<G> search_;
+    BatchScorer<G> scorer_;
+
+    TripleBuffer<position_t> positions_;
+    TripleBuffer<enemy_t> enemies_;
+    std::atomic<bool> stop_{false};
+    std::thread enemy_model_;
+};
+
+} // anonymous namespace
+
+std::unique_ptr<Planner> make_planner(Engine engine, const Evaluator *evaluator,
+                                      rand_stream_t *my_rng, rand_stream_t *enemy_rng) {
+    return std::make_unique<PlannerT<Genome>>(engine, evaluator, my_rng, enemy_rng);
+}
+
+std::unique_ptr<Planner> make_pipelined_planner(Engine engine, const Evaluator *evaluator,
+                                                const Game *game, const World &start,
+                                                rand_stream_t *my_rng, rand_stream_t *enemy_rng) {
+    return std::make_unique<PipelinedPlannerT<Genome>>(engine, evaluator, game, start, my_rng, enemy_rng);
 }
 
+//Used directly by offline tools
+template class GenomeT<12, 5>;
+template class BatchScorer<Genome>;
+template void hill_climb(Genome *solution, BatchScorer<Genome> &scorer, int count, bool shake);
+template class Population<Genome>;
+template class TreeSearch<Genome>;
 
-} // namespace montecarlo
\ No newline at end of file
+} // namespace montecarlo
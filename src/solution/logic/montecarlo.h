@@ -6,31 +6,42 @@
 
 #include "../structures.h"
 #include "../simulation/simulator.h"
+#include "fastrand.h"
 
 #include <cstdint>
+#include <memory>
 #include <optional>
+#include <vector>
 
 namespace montecarlo {
 
-class Genome {
+///Genome is a plan of DEPTH actions, each lasts TURN_LEN ticks
+///Horizon is a template parameter, so every loop over genome has constant bounds
+template <uint8_t Depth, uint8_t TurnLen>
+class GenomeT {
 public:
     ///Count of actions in genome
-    static constexpr uint8_t DEPTH = 12;
+    static constexpr uint8_t DEPTH = Depth;
     ///Each action should lasts TURN_LEN turns
-    static constexpr uint8_t TURN_LEN = 5;
+    static constexpr uint8_t TURN_LEN = TurnLen;
 
-    Genome(const Evaluator *evaluator, bool with_random);
+    ///Random stream is shared by genome and its children, one stream per search keeps it reproducible
+    GenomeT(const Evaluator *evaluator, rand_stream_t *rng, bool with_random);
 
-    void duplicate(Genome &other);
+    void duplicate(GenomeT &other);
 
     void shift();
 
-    void mutate();
+    ///Randomize actions on times random positions, returns bit of every position written
+    uint32_t mutate(int times = 1);
 
-    void mutate(Genome *other) const;
+    uint32_t mutate(GenomeT *other, int times = 1) const;
+
+    ///Child takes actions of this genome before a random cut and actions of other after it
+    void crossover(const GenomeT &other, GenomeT *child) const;
 
     ///Simulator should be in normal state
-    double get_score(Simulator &sim, cp::transaction_t &mut_buffer, const Genome &enemy);
+    double get_score(Simulator &sim, cp::transaction_t &mut_buffer, const GenomeT &enemy);
 
     Action get_action() const;
 
@@ -45,6 +56,191 @@ public:
     int small_shift_ = 0;
 
     const Evaluator *evaluator_;
+    rand_stream_t *rng_;
+};
+
+///12 actions of 5 ticks
+using Genome = GenomeT<12, 5>;
+
+///Scores batches of genomes played against the same enemy genome from the same origin state
+///Each rollout is saved per action level, so genome sharing action prefix with the best scored one
+///restores its snapshot instead of simulating those steps again
+template <class G>
+class BatchScorer {
+public:
+    ///Simulator should be in origin state, which is saved in origin
+    void reset(Simulator &sim, cp::transaction_t &origin, const G &enemy);
+
+    double score(G &genome);
+
+    void score(G *genomes, size_t count);
+
+    ///Levels the last scored genome was simulated for, the rest was restored from reference rollout
+    int simulated_levels() const {
+        return simulated_levels_;
+    }
+
+private:
+    struct level_t {
+        cp::transaction_t dump;
+        double score;
+        bool finished;
+    };
+
+    ///Count of leading levels of reference path which are valid for genome
+    int common_prefix(const G &genome) const;
+
+    Simulator *sim_ = nullptr;
+    cp::transaction_t *origin_ = nullptr;
+    const G *enemy_ = nullptr;
+
+    ///Rollout of best scored genome
+    Action ref_actions_[G::DEPTH];
+    int ref_shift_ = 0;
+    int ref_levels_ = 0;
+    double ref_score_ = 0.0;
+    level_t ref_[G::DEPTH];
+
+    ///Rollout of last scored genome
+    level_t last_[G::DEPTH];
+    int simulated_levels_ = 0;
+};
+
+///Hill climbing over count mutations of solution, scored against enemy set in scorer
+///With shake first mutations are stronger to escape local maximum
+template <class G>
+void hill_climb(G *solution, BatchScorer<G> &scorer, int count, bool shake);
+
+///Evolutionary search: tournament selection, crossover and mutation, the best genomes survive
+///to the next generation unchanged. Population is kept between searches, shifted with solutions,
+///so most of the work of previous search is not lost
+template <class G>
+class Population {
+public:
+    static constexpr int SIZE = 10;
+    ///Survivors of every generation
+    static constexpr int ELITE = 2;
+    static constexpr int TOURNAMENT = 3;
+
+    Population(const Evaluator *evaluator, rand_stream_t *rng);
+
+    void shift();
+
+    ///Evolves generations until count genomes are scored, solution takes part and is replaced
+    ///with the best genome found. Every generation is scored as a batch
+    void evolve(G *solution, BatchScorer<G> &scorer, int count);
+
+private:
+    ///Index of the best of TOURNAMENT random genomes of current generation
+    int tournament() const;
+
+    std::vector<G> generation_;
+    std::vector<G> next_;
+    rand_stream_t *rng_;
 };
 
+///Monte Carlo tree search over my actions lasting TURN_LEN ticks, enemy plays its solution
+///Nodes keep snapshots of their states and statistics of returns. Subtree of the action taken becomes
+///the next root, so statistics of previous searches are reused. Origin never matches the predicted state
+///exactly, so snapshots of reused nodes are simulated again when they are visited
+template <class G>
+class TreeSearch {
+public:
+    ///Nodes are pooled, tree is not expanded when the pool is exhausted
+    static constexpr int MAX_NODES = 256;
+
+    TreeSearch(const Evaluator *evaluator, rand_stream_t *rng);
+
+    void shift();
+
+    ///Runs count iterations from origin, solution takes the most visited path
+    ///Simulator should be in origin state, which is saved in origin
+    void search(G *solution, Simulator &sim, cp::transaction_t &origin, const G &enemy, int count);
+
+private:
+    struct node_t {
+        ///Node of every action, -1 if it is not expanded
+        int children[3];
+        int visits;
+        ///Sum of returns from this level on, discounted relative to it
+        double value_sum;
+        ///Evaluation of the state after action of the node
+        double eval;
+        bool finished;
+        ///Search the state was simulated in, state of an older one is stale
+        uint32_t generation;
+        cp::transaction_t state;
+    };
+
+    int alloc_node();
+
+    void release(int idx);
+
+    ///Child of node for action, expanded if pool allows, -1 otherwise
+    int select(int idx);
+
+    ///Brings simulator to the state of child of parent, simulating it if it is stale
+    void enter(int parent, int child, Action action, int level, cp::transaction_t &origin, const G &enemy);
+
+    ///Ticks action of level lasts
+    int level_ticks(int level) const;
+
+    const Evaluator *evaluator_;
+    rand_stream_t *rng_;
+    Simulator *sim_ = nullptr;
+
+    std::vector<node_t> nodes_;
+    std::vector<int> free_;
+    int root_;
+    ///Node state simulator is in
+    int current_ = -1;
+    uint32_t generation_ = 0;
+    int small_shift_ = 0;
+    ///Root action returned by the last search
+    Action committed_ = Action::STOP;
+    ///Range of returns seen in current search, exploration is scaled by it
+    double min_return_ = 0.0;
+    double max_return_ = 0.0;
+};
+
+//MARK: Planner
+
+///How my solution is searched, enemy one is always hill climbed
+enum class Engine {
+    HILL_CLIMB, ///Single genome, mutation kept if it is better
+    EVOLUTION,  ///Population, see Population
+    TREE,       ///Tree search, see TreeSearch
+};
+
+///My and enemy solutions with their scorer, so strategy does not depend on genome type
+class Planner {
+public:
+    virtual ~Planner() = default;
+
+    virtual int turn_len() const = 0;
+
+    ///Advance solutions by one tick
+    virtual void shift() = 0;
+
+    ///Improve enemy solution against mine and then mine against enemy one
+    ///Simulator should be in origin state, which is saved in origin. It is reached from the round start
+    ///by my_actions and enemy_actions, one per past tick
+    virtual void search(Simulator &sim, cp::transaction_t &origin,
+                        const std::vector<Action> &my_actions, const std::vector<Action> &enemy_actions,
+                        int enemy_mutations, int my_mutations) = 0;
+
+    virtual Action action() const = 0;
+};
+
+std::unique_ptr<Planner> make_planner(Engine engine, const Evaluator *evaluator,
+                                      rand_stream_t *my_rng, rand_stream_t *enemy_rng);
+
+///Enemy solution is searched continuously on a separate thread against my latest one, my search takes
+///the newest enemy solution published and does not wait for it. The thread follows the round from start
+///on its own simulator by actions passed to search, enemy_mutations scale its budget per origin
+///Results depend on thread timing, so matches are not reproducible with it
+std::unique_ptr<Planner> make_pipelined_planner(Engine engine, const Evaluator *evaluator,
+                                                const Game *game, const World &start,
+                                                rand_stream_t *my_rng, rand_stream_t *enemy_rng);
+
 } // namespace montecarlo
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "opening_book.h"
+
+#include <cstring>
+
+namespace {
+
+struct book_entry_t {
+    int map_id;
+    int car_id;
+    int x_modification;
+    const char *actions;
+};
+
+const book_entry_t k_book[] = {
+#include "opening_book.inc"
+    {0, 0, 0, nullptr}
+};
+
+} // anonymous namespace
+
+OpeningBook::OpeningBook() {
+    for (const auto &entry : k_book) {
+        if (!entry.actions
+            || entry.map_id < 0 || entry.map_id >= MAX_MAP_ID
+            || entry.car_id < 0 || entry.car_id >= MAX_CAR_ID) {
+            continue;
+        }
+        auto &line = lines_[entry.map_id][entry.car_id][entry.x_modification == -1];
+        line.actions = entry.actions;
+        line.length = static_cast<int>(strlen(entry.actions));
+    }
+}
+
+void OpeningBook::select(int map_id, int car_id, int x_modification) {
+    selected_ = line_t{};
+    if (map_id >= 0 && map_id < MAX_MAP_ID && car_id >= 0 && car_id < MAX_CAR_ID) {
+        selected_ = lines_[map_id][car_id][x_modification == -1];
+    }
+}
+
+Action OpeningBook::get(int tick) const {
+    if (tick < 0 || tick >= selected_.length) {
+        return Action::UNKNOWN;
+    }
+    return decode(selected_.actions[tick]);
+}
+
+int OpeningBook::length() const {
+    return selected_.length;
+}
+
+Action OpeningBook::decode(char c) {
+    switch (c) {
+        case 'L': return Action::LEFT;
+        case 'R': return Action::RIGHT;
+        case 'S': return Action::STOP;
+        default: return Action::UNKNOWN;
+    }
+}
+
+char OpeningBook::encode(Action action) {
+    switch (action) {
+        case Action::LEFT: return 'L';
+        case Action::RIGHT: return 'R';
+        case Action::STOP: return 'S';
+        default: return '?';
+    }
+}
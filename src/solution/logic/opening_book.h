@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../structures.h"
+
+///Precomputed first actions per map, car and side. Lines are generated offline by tools/opening_book_gen
+///and compiled in from opening_book.inc
+class OpeningBook {
+public:
+    static constexpr int MAX_MAP_ID = 8;
+    static constexpr int MAX_CAR_ID = 4;
+
+    OpeningBook();
+
+    ///Choose line for current round, side is x_modification of my car
+    void select(int map_id, int car_id, int x_modification);
+
+    ///Book action on tick or Action::UNKNOWN when out of book
+    Action get(int tick) const;
+
+    ///Count of ticks covered by selected line
+    int length() const;
+
+    static Action decode(char c);
+
+    static char encode(Action action);
+
+private:
+    struct line_t {
+        const char *actions = nullptr;
+        int length = 0;
+    };
+
+    line_t lines_[MAX_MAP_ID][MAX_CAR_ID][2];
+    line_t selected_;
+};
@@ -0,0 +1,96 @@
+#include "search_trace.h"
+
+#if defined(LOCAL_RUN) && defined(ENABLE_SEARCH_TRACE)
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace search_trace {
+
+namespace {
+
+constexpr const char *k_trace_path = "search.trace";
+
+class Writer {
+public:
+    static Writer &instance() {
+        static Writer writer;
+        return writer;
+    }
+
+    void write(const std::vector<uint8_t> &climb) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (file_) {
+            fwrite(climb.data(), 1, climb.size(), file_);
+        }
+    }
+
+private:
+    Writer() {
+        file_ = fopen(k_trace_path, "wb");
+        if (file_) {
+            file_header_t header{};
+            memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = VERSION;
+            fwrite(&header, sizeof(header), 1, file_);
+        }
+    }
+
+    ~Writer() {
+        if (file_) {
+            fclose(file_);
+        }
+    }
+
+    std::mutex mutex_;
+    FILE *file_ = nullptr;
+};
+
+///Climb being recorded on this thread
+struct context_t {
+    int turn = -1;
+    side_t side = side_t::ME;
+    std::vector<uint8_t> climb;
+};
+
+thread_local context_t t_context;
+
+template <typename T>
+void append(std::vector<uint8_t> &out, const T &value) {
+    const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+} // anonymous namespace
+
+void set_context(int turn, side_t side) {
+    t_context.turn = turn;
+    t_context.side = side;
+}
+
+void begin_climb(uint8_t depth, uint8_t turn_len, bool shake, int count) {
+    climb_t climb{};
+    climb.turn = t_context.turn;
+    climb.side = t_context.side;
+    climb.depth = depth;
+    climb.turn_len = turn_len;
+    climb.shake = shake;
+    climb.count = static_cast<uint32_t>(count);
+    t_context.climb.clear();
+    append(t_context.climb, climb);
+}
+
+void add_mutation(const mutation_t &mutation) {
+    append(t_context.climb, mutation);
+}
+
+void end_climb() {
+    Writer::instance().write(t_context.climb);
+    t_context.climb.clear();
+}
+
+} // namespace search_trace
+
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+///Telemetry of hill climbing for tuning of search budget: every mutation with its phase, acceptance,
+///scores, genome positions changed and levels simulated for it. Recorded with LOCAL_RUN and
+///ENABLE_SEARCH_TRACE only, to search.trace in working directory, see tools/search_trace_summary.cpp
+///File is the header followed by climbs, each is climb_t and count of mutation_t
+namespace search_trace {
+
+constexpr char MAGIC[8] = {'S', 'R', 'C', 'H', 'T', 'R', 'C', 'E'};
+constexpr uint32_t VERSION = 1;
+
+enum class side_t : uint8_t {
+    ME,
+    ENEMY,
+};
+
+///Mutations per child are 3 in STRONG phase, 2 in MEDIUM one, 1 in the rest, see hill_climb
+enum class phase_t : uint8_t {
+    STRONG,
+    MEDIUM,
+    FINE,
+};
+
+struct file_header_t {
+    char magic[8];
+    uint32_t version;
+};
+
+struct climb_t {
+    int32_t turn;
+    side_t side;
+    uint8_t depth;
+    uint8_t turn_len;
+    uint8_t shake;
+    uint32_t count;
+};
+
+struct mutation_t {
+    uint16_t index;
+    phase_t phase;
+    uint8_t accepted;
+    ///Bit of every genome position mutation wrote to
+    uint32_t positions;
+    float parent_score;
+    float child_score;
+    ///Levels child was simulated for, the rest was restored from reference rollout
+    uint8_t levels;
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(climb_t) == 12 && sizeof(mutation_t) == 20, "Trace layout is a file format");
+
+#if defined(LOCAL_RUN) && defined(ENABLE_SEARCH_TRACE)
+
+///Turn and side of following climbs on the calling thread
+void set_context(int turn, side_t side);
+
+void begin_climb(uint8_t depth, uint8_t turn_len, bool shake, int count);
+
+void add_mutation(const mutation_t &mutation);
+
+///Writes climb to the trace, threads append whole climbs
+void end_climb();
+
+#endif
+
+} // namespace search_trace
+
+#if defined(LOCAL_RUN) && defined(ENABLE_SEARCH_TRACE)
+
+#define SEARCH_TRACE(...) search_trace::__VA_ARGS__;
+
+#else
+
+#define SEARCH_TRACE(...)
+
+#endif
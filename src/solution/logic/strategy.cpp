@@ -18,75 +18,95 @@
 #include <chipmunk/chipmunk.h>
 #include <chipmunk/chipmunk_structs.h>
 
+#include <cassert>
 #include <chrono>
 
-Strategy::~Strategy() = default;
+namespace {
+
+constexpr int k_enemy_mutations = 20;
+constexpr int k_my_mutations = 50;
+constexpr double k_contested_dist = 250.0;
+
+} // anonymous namespace
+
+Strategy::Strategy(bool pipelined, montecarlo::Engine engine)
+    : pipelined_(pipelined)
+    , engine_(engine) {
+}
+
+Strategy::~Strategy() {
+    watchdog_.report_match();
+}
 
 void Strategy::next_match(Game game) {
+    watchdog_.report_match();
+    //Joins enemy model thread, which still searches in the previous round
+    planner_ = nullptr;
+    evaluator_ = nullptr;
+
     game_ = std::move(game);
     sim_.init(&game_);
     turn_idx_ = -1;
-
-    evaluator_ = nullptr;
-    solution_ = nullptr;
+    history_.clear();
+    my_actions_.clear();
+    enemy_actions_.clear();
+    banked_searches_ = 0;
 }
 
 //MARK: move
 
-Action Strategy::move(World world) {
+Action Strategy::move(World world, LatencyWatchdog::clock::time_point received) {
+    watchdog_.start_tick(received);
     on_tick_start(world);
     sim_precision_checker(world);
 
+    if (!planner_) {
+        if (pipelined_) {
+            planner_ = montecarlo::make_pipelined_planner(engine_, evaluator_.get(), &game_, world,
+                                                          &my_rng_, &enemy_rng_);
+        } else {
+            planner_ = montecarlo::make_planner(engine_, evaluator_.get(), &my_rng_, &enemy_rng_);
+        }
+    }
+
+    const Action book_action = book_.get(turn_idx_);
+    if (book_action != Action::UNKNOWN) {
+        if (turn_idx_ % planner_->turn_len() == 0) {
+            ++banked_searches_;
+        }
+        VIS_MESSAGE("BOOK %c; %d/%d\\n", OpeningBook::encode(book_action), turn_idx_, book_.length());
+        return on_tick_end(book_action);
+    }
+
     auto heurisitcs_action = heuristics_control();
     if (heurisitcs_action != Action::UNKNOWN) {
         VIS_MESSAGE("HEURISTICS %s; air %d\\n",
                     heurisitcs_action == Action::STOP ? "STOP" : heurisitcs_action == Action::LEFT ? "LEFT" : "RIGHT",
                     sim_.world_native().me().in_air);
-        return on_tick_end(heurisitcs_action, world);
-    }
-
-    using montecarlo::Genome;
-    if (!solution_) {
-        solution_ = std::make_unique<Genome>(evaluator_.get(), true);
-        enemy_solution_ = std::make_unique<Genome>(evaluator_.get(), true);
+        return on_tick_end(heurisitcs_action);
     }
 
     if (turn_idx_ > 0) {
-        solution_->shift();
-        enemy_solution_->shift();
+        planner_->shift();
     }
 
-    if (turn_idx_ % Genome::TURN_LEN == 0) {
-        Genome child(evaluator_.get(), false);
-        sim_.save(active_buf_);
-
-        sim_.swap_sides();
-        for (int cnt = 0; cnt < 20; ++cnt) {
-            enemy_solution_->mutate(&child);
-            if (child.get_score(sim_, active_buf_, *solution_.get())
-                > enemy_solution_->get_score(sim_, active_buf_, *solution_.get())) {
-                child.duplicate(*enemy_solution_);
-            }
-        }
-        sim_.swap_sides(); //Return me back
-
-        for (int cnt = 0; cnt < 50; ++cnt) {
-            solution_->mutate(&child);
-            if (cnt < 10) {
-                child.mutate();
-                child.mutate();
-            } else if (cnt < 30) {
-                child.mutate();
-            }
-
-            if (child.get_score(sim_, active_buf_, *enemy_solution_.get())
-                > solution_->get_score(sim_, active_buf_, *enemy_solution_.get())) {
-                child.duplicate(*solution_);
-            }
+    int search_period = 0;
+    if (turn_idx_ % planner_->turn_len() == 0) {
+        //Banked searches wait while watchdog cuts budget, banked one spends time of the skipped turn too
+        double budget = watchdog_.budget_factor();
+        search_period = planner_->turn_len();
+        if (banked_searches_ > 0 && is_contested() && watchdog_.level() == 0) {
+            --banked_searches_;
+            budget *= 2;
+            search_period *= 2;
         }
+        sim_.save(active_buf_);
+        planner_->search(sim_, active_buf_, my_actions_, enemy_actions_,
+                         std::max(1, static_cast<int>(k_enemy_mutations * budget)),
+                         std::max(1, static_cast<int>(k_my_mutations * budget)));
     }
 
-    return on_tick_end(solution_->get_action(), world);
+    return on_tick_end(planner_->action(), search_period);
 }
 
 Action Strategy::heuristics_control() {
@@ -233,6 +253,13 @@ Action Strategy::heuristics_control() {
     return ret;
 }
 
+bool Strategy::is_contested() const {
+    const auto &world = sim_.world_native();
+    const vec2 my_pos = cpBodyGetPosition(world.me().body);
+    const vec2 en_pos = cpBodyGetPosition(world.enemy().body);
+    return (my_pos - en_pos).len() < k_contested_dist;
+}
+
 std::string Strategy::debug_string() {
     char buf[100];
     sprintf(buf, "%e", sum_err_);
@@ -244,9 +271,10 @@ void Strategy::on_tick_start(const World &origin) {
     VIS_MESSAGE("Me %d; Enemy %d; Turn %d\\n", game_.lives[0], game_.lives[1], turn_idx_)
     if (turn_idx_ == 0) {
         sim_.set_world(origin);
+        book_.select(game_.proto_map_external_id, game_.proto_car.external_id, origin.me().x_modification);
         cp::print_memory_usage();
     } else {
-        sim_.step(turn_action_[0]);
+        sim_.step(my_actions_[turn_idx_ - 1], enemy_actions_[turn_idx_ - 1]);
     }
     if (turn_idx_ > 1) {
         ensure_perfect_simulation(origin);
@@ -257,20 +285,17 @@ void Strategy::on_tick_start(const World &origin) {
     }
 }
 
-Action Strategy::on_tick_end(Action action, const World &origin) {
+Action Strategy::on_tick_end(Action action, int search_period) {
     draw_game(game_, 1);
     sim_.draw();
     VIS_END_FRAME();
 
-    //Advance turn
-    std::swap(turn_dump_[0], turn_dump_[1]);
-    std::swap(turn_action_[0], turn_action_[1]);
-    std::swap(enemy_wheel_angle_[0], enemy_wheel_angle_[1]);
-
-    //Save in previous turn
-    sim_.save(turn_dump_[0]);
-    turn_action_[0] = action;
-    enemy_wheel_angle_[0] = get_drive_wheel_angle(origin);
+    //Save in history
+    sim_.save(active_buf_);
+    history_.push(active_buf_);
+    my_actions_.push_back(action);
+    enemy_actions_.push_back(Action::STOP);
+    watchdog_.end_tick(search_period);
 
     return action;
 }
@@ -281,16 +306,32 @@ void Strategy::ensure_perfect_simulation(const World &world) {
     if (!eps_eq(now_angle, predicted_angle)) {
         //Ok, it was not stop action 2 ticks before
         Action enemy_act = now_angle > predicted_angle ? Action::LEFT : Action::RIGHT;
-        sim_.restore(turn_dump_[1]);
-        sim_.step(turn_action_[1], enemy_act);
-        sim_.save(turn_dump_[0]);
-        sim_.step(turn_action_[0]);
+        resimulate(turn_idx_ - 2, enemy_act);
         VIS_MESSAGE("enemy action %s\\n", enemy_act == Action::RIGHT ? "RIGHT" : "LEFT");
     } else {
         VIS_MESSAGE("enemy action %s\\n", "STOP");
     }
 }
 
+void Strategy::resimulate(int turn, Action enemy_action) {
+    //History holds states saved on the end of turns up to the previous one
+    const int age = turn_idx_ - 1 - turn;
+    assert(age >= 0 && age < history_.size());
+
+    history_.get(age, active_buf_);
+    sim_.restore(active_buf_);
+    history_.drop(age);
+    enemy_actions_[turn] = enemy_action;
+
+    for (int t = turn; t < turn_idx_; ++t) {
+        if (t > turn) {
+            sim_.save(active_buf_);
+            history_.push(active_buf_);
+        }
+        sim_.step(my_actions_[t], enemy_actions_[t]);
+    }
+}
+
 double Strategy::get_drive_wheel_angle(const World &w) const {
     const auto &enemy = w.cars[1 - w.my_id];
     bool is_rear_drive = game_.proto_car.drive == ProtoCar::FR;
@@ -320,4 +361,6 @@ void Strategy::sim_precision_checker(const World &world) {
     if (sum_err_ > 0.0) {
         LOG_WARN("Simulation error not zero: %e", sum_err_);
     }
+    //Hash is taken only when logged, strategy.log of two builds can be diffed tick by tick
+    LOG_V5("Turn %d state hash %016llx", turn_idx_, static_cast<unsigned long long>(sim_.state_hash()));
 }
@@ -5,43 +5,63 @@
 #pragma once
 
 #include "../simulation/simulator.h"
+#include "../simulation/snapshot_ring.h"
 #include "../structures.h"
 #include "montecarlo.h"
 #include "evaluator.h"
+#include "fastrand.h"
+#include "latency_watchdog.h"
+#include "opening_book.h"
 
 #include <chrono>
+#include <vector>
 
 class Strategy {
+    ///Count of past turns which can be re-simulated
+    static constexpr int HISTORY_LEN = 16;
+    ///Server limits total time of the game and its ticks, watchdog keeps every search within its share
+    static constexpr std::chrono::milliseconds GAME_TIME_LIMIT{120000};
+    static constexpr int GAME_TICK_LIMIT = 20000;
 public:
+    ///Pipelined enemy model takes a core of its own and makes matches depend on thread timing, so it is opt in
+    ///Engine searches my solution, enemy one is always hill climbed
+    explicit Strategy(bool pipelined = false, montecarlo::Engine engine = montecarlo::Engine::HILL_CLIMB);
+
     ~Strategy();
 
     void next_match(Game game);
 
-    Action move(World world);
+    ///Received is the time input arrived, so parsing counts in tick latency
+    Action move(World world, LatencyWatchdog::clock::time_point received = LatencyWatchdog::clock::now());
 
     std::string debug_string();
 
 private:
     Action heuristics_control();
 
+    ///Cars are close enough for banked searches to be spent
+    bool is_contested() const;
+
     void on_tick_start(const World &origin);
 
-    ///Should be issued on turn end
-    Action on_tick_end(Action action, const World &origin);
+    ///Should be issued on turn end, search period is count of ticks search of this turn plans for
+    Action on_tick_end(Action action, int search_period = 0);
 
     ///Predict opponent move on previous turn
     void ensure_perfect_simulation(const World &world);
 
+    ///Replace enemy action on past turn and simulate again up to current one
+    void resimulate(int turn, Action enemy_action);
+
     double get_drive_wheel_angle(const World &w) const;
 
     void sim_precision_checker(const World &world);
 
-    //Dumps to preserve simulation precision
-    //0 - previous turn
-    //1 - turn before previous
-    cp::transaction_t turn_dump_[2];
-    Action turn_action_[2];
-    double enemy_wheel_angle_[2];
+    //States on the end of past turns, to preserve simulation precision
+    cp::SnapshotRing history_{HISTORY_LEN};
+    ///Actions taken on every turn of the round, enemy ones are predicted
+    std::vector<Action> my_actions_;
+    std::vector<Action> enemy_actions_;
 
     ///For various simulations
     cp::transaction_t active_buf_;
@@ -52,7 +72,18 @@ private:
 
     double sum_err_ = 0.0;
 
-    std::unique_ptr<montecarlo::Genome> solution_;
-    std::unique_ptr<montecarlo::Genome> enemy_solution_;
+    const bool pipelined_;
+    const montecarlo::Engine engine_;
+    ///Separate streams, so my and enemy searches are reproducible independently of each other
+    rand_stream_t my_rng_{RANDOM_SEED, 0};
+    rand_stream_t enemy_rng_{RANDOM_SEED, 1};
     std::unique_ptr<Evaluator> evaluator_;
+    ///Uses game, evaluator and streams above, also from enemy model thread, so it is destroyed first
+    std::unique_ptr<montecarlo::Planner> planner_;
+
+    OpeningBook book_;
+    ///Searches skipped on book moves, spent later as deeper searches
+    int banked_searches_ = 0;
+
+    LatencyWatchdog watchdog_{GAME_TIME_LIMIT, GAME_TICK_LIMIT};
 };
\ No newline at end of file
@@ -3,10 +3,15 @@
 #include "common/logger.h"
 #include "common/json.h"
 #include "common/RewindClient.h"
+#include "common/replay.h"
+#include "session_server.h"
 #include "structures.h"
 
 #include <vector>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 
 unsigned int RANDOM_SEED = 42;
 
@@ -17,6 +22,19 @@ void local_dump(std::string_view line) {
 #endif
 }
 
+bool parse_engine(const char *name, montecarlo::Engine &engine) {
+    if (!strcmp(name, "hill_climb")) {
+        engine = montecarlo::Engine::HILL_CLIMB;
+    } else if (!strcmp(name, "evolution")) {
+        engine = montecarlo::Engine::EVOLUTION;
+    } else if (!strcmp(name, "tree")) {
+        engine = montecarlo::Engine::TREE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 int main(int argc, char *argv[]) {
 #ifdef ENABLE_LOG
     loguru::g_preamble_thread = false;
@@ -25,11 +43,63 @@ int main(int argc, char *argv[]) {
 
     loguru::init(argc, argv);
     loguru::add_file("strategy.log", loguru::Truncate, 6);
+    async_log::Backend::instance().start();
 #endif
 
+    //Usage: madcar [--pipelined] [--engine hill_climb|evolution|tree] [replay]
+    //       madcar [--pipelined] [--engine hill_climb|evolution|tree] --serve socket_path [workers]
+    bool pipelined = false;
+    montecarlo::Engine engine = montecarlo::Engine::HILL_CLIMB;
+    const char *serve_path = nullptr;
+    int arg = 1;
+    for (; arg < argc && !strncmp(argv[arg], "--", 2); ++arg) {
+        if (!strcmp(argv[arg], "--pipelined")) {
+            pipelined = true;
+        } else if (arg + 1 < argc && !strcmp(argv[arg], "--serve")) {
+            serve_path = argv[++arg];
+        } else if (arg + 1 < argc && !strcmp(argv[arg], "--engine")) {
+            if (!parse_engine(argv[++arg], engine)) {
+                LOG_FATAL("Unknown engine %s", argv[arg]);
+                return -1;
+            }
+        } else {
+            LOG_FATAL("Unknown option %s", argv[arg]);
+            return -1;
+        }
+    }
+
+    if (serve_path) {
+        const int workers = arg < argc ? atoi(argv[arg]) : static_cast<int>(std::thread::hardware_concurrency());
+        const int ret = session_server::run(serve_path, std::max(1, workers), pipelined, engine);
+#ifdef ENABLE_LOG
+        async_log::Backend::instance().stop();
+#endif
+        return ret;
+    }
+
+    if (arg < argc && replay::Reader::is_binary(argv[arg])) {
+        LOG_INFO("Replaying binary file %s", argv[arg]);
+        replay::Reader reader(argv[arg]);
+        if (!reader.ok()) {
+            LOG_FATAL("Cannot read binary replay %s", argv[arg]);
+            return -1;
+        }
+        Strategy agent(pipelined, engine);
+        for (const auto &match : reader.matches()) {
+            agent.next_match(match.game);
+            for (int i = 0; i < match.tick_count; ++i) {
+                agent.move(match.worlds[i]);
+            }
+        }
+#ifdef ENABLE_LOG
+        async_log::Backend::instance().stop();
+#endif
+        return 0;
+    }
+
     FILE *inp_stream = stdin;
-    if (argc > 1) {
-        const char *replay = argv[1];
+    if (arg < argc) {
+        const char *replay = argv[arg];
         inp_stream = fopen(replay, "r");
         if (!inp_stream) {
             LOG_FATAL("Cannot open local file %s", replay);
@@ -41,10 +111,11 @@ int main(int argc, char *argv[]) {
     const bool is_replay = inp_stream != stdin;
 
     char buf[65536];
-    Strategy agent;
+    Strategy agent(pipelined, engine);
     bool is_exit_requested = false;
     for (int turn = 0; !is_exit_requested; ++turn) {
         fgets(buf, sizeof(buf), inp_stream);
+        const auto received = LatencyWatchdog::clock::now();
         if (!is_replay) {
             local_dump(buf);
         }
@@ -60,7 +131,7 @@ int main(int argc, char *argv[]) {
             LOG_DEBUG("New match started");
             agent.next_match(j["params"].get<Game>());
         } else if (type == "tick") {
-            Action decision = agent.move(j["params"].get<World>());
+            Action decision = agent.move(j["params"].get<World>(), received);
             if (!is_replay) {
                 puts(action_to_command(decision, agent.debug_string()).c_str());
             }
@@ -75,5 +146,8 @@ int main(int argc, char *argv[]) {
         fclose(inp_stream);
     }
 
+#ifdef ENABLE_LOG
+    async_log::Backend::instance().stop();
+#endif
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,306 @@
+#include "session_server.h"
+#include "logic/strategy.h"
+#include "simulation/cp_helpers.h"
+#include "common/logger.h"
+#include "common/json.h"
+#include "structures.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace session_server {
+
+namespace {
+
+constexpr int k_max_events = 64;
+constexpr size_t k_read_chunk = 65536;
+
+std::atomic<bool> g_stop{false};
+
+void on_stop_signal(int) {
+    g_stop.store(true);
+}
+
+struct session_t {
+    session_t(int fd_, int id_, bool pipelined_, montecarlo::Engine engine_)
+        : fd(fd_)
+        , id(id_)
+        , pipelined(pipelined_)
+        , engine(engine_) {
+    }
+
+    ~session_t() {
+        //Strategy frees chipmunk objects into its own arena
+        {
+            cp::ArenaScope scope(arena);
+            agent.reset();
+        }
+        close(fd);
+    }
+
+    const int fd;
+    const int id;
+    const bool pipelined;
+    const montecarlo::Engine engine;
+    cp::Arena arena;
+    ///Created on the first message, inside scope of session arena
+    std::optional<Strategy> agent;
+    ///Protocol end message was processed, the rest of input is ignored
+    bool finished = false;
+
+    std::mutex mutex;
+    ///Guarded by mutex. Received bytes which are not processed yet
+    std::string input;
+    ///Guarded by mutex. Time every complete line of input was read off the socket, so latency budget
+    ///counts time the session waited for a worker
+    std::deque<LatencyWatchdog::clock::time_point> received;
+    ///Guarded by mutex. Session is queued or processed by a worker
+    bool scheduled = false;
+};
+
+using session_ptr = std::shared_ptr<session_t>;
+
+bool send_all(int fd, const std::string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+        } else if (n < 0 && errno == EAGAIN) {
+            pollfd p{fd, POLLOUT, 0};
+            poll(&p, 1, -1);
+        } else if (n < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+///Handles one protocol line, the same way main does for stdin
+void handle_line(session_t &session, const std::string &line, LatencyWatchdog::clock::time_point received) {
+    const auto j = nlohmann::json::parse(line);
+    const auto type = j["type"].get<std::string>();
+    if (type == "new_match") {
+        LOG_DEBUG("Session %d: new match", session.id);
+        session.agent->next_match(j["params"].get<Game>());
+    } else if (type == "tick") {
+        const Action decision = session.agent->move(j["params"].get<World>(), received);
+        if (!send_all(session.fd, action_to_command(decision, session.agent->debug_string()) + "\n")) {
+            LOG_WARN("Session %d: client is gone", session.id);
+            session.finished = true;
+        }
+    } else {
+        session.finished = true;
+    }
+}
+
+///Processes complete lines of session input until there are none
+void process(session_t &session) {
+    cp::ArenaScope scope(session.arena);
+    if (!session.agent) {
+        session.agent.emplace(session.pipelined, session.engine);
+    }
+
+    std::string line;
+    LatencyWatchdog::clock::time_point received;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(session.mutex);
+            const size_t end = session.input.find('\n');
+            if (end == std::string::npos) {
+                session.scheduled = false;
+                return;
+            }
+            line.assign(session.input, 0, end + 1);
+            session.input.erase(0, end + 1);
+            received = session.received.front();
+            session.received.pop_front();
+        }
+        if (session.finished) {
+            continue;
+        }
+        //One broken client should not stop the whole farm
+        try {
+            handle_line(session, line, received);
+        } catch (const std::exception &e) {
+            LOG_ERROR("Session %d: %s", session.id, e.what());
+            session.finished = true;
+        }
+    }
+}
+
+class WorkerPool {
+public:
+    explicit WorkerPool(int workers) {
+        for (int i = 0; i < workers; ++i) {
+            threads_.emplace_back(&WorkerPool::work, this);
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        for (auto &thread : threads_) {
+            thread.join();
+        }
+    }
+
+    void push(session_ptr session) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(session));
+        }
+        ready_.notify_one();
+    }
+
+private:
+    void work() {
+        for (;;) {
+            session_ptr session;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (stopping_) {
+                    return;
+                }
+                session = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            process(*session);
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<session_ptr> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
+
+int listen_unix(const char *path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path %s is too long\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        perror(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+} // anonymous namespace
+
+int run(const char *socket_path, int workers, bool pipelined, montecarlo::Engine engine) {
+    const int listen_fd = listen_unix(socket_path);
+    if (listen_fd < 0) {
+        return 1;
+    }
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event listen_event{};
+    listen_event.events = EPOLLIN;
+    listen_event.data.fd = listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &listen_event);
+
+    signal(SIGINT, on_stop_signal);
+    signal(SIGTERM, on_stop_signal);
+    LOG_INFO("Serving on %s with %d workers", socket_path, workers);
+
+    WorkerPool pool(workers);
+    std::map<int, session_ptr> sessions;
+    int session_count = 0;
+    std::vector<char> buf(k_read_chunk);
+    epoll_event events[k_max_events];
+    while (!g_stop.load()) {
+        const int count = epoll_wait(epoll_fd, events, k_max_events, -1);
+        for (int e = 0; e < count; ++e) {
+            const int fd = events[e].data.fd;
+            if (fd == listen_fd) {
+                int client;
+                while ((client = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    epoll_event event{};
+                    event.events = EPOLLIN;
+                    event.data.fd = client;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client, &event);
+                    sessions[client] = std::make_shared<session_t>(client, session_count++, pipelined, engine);
+                    LOG_INFO("Session %d: connected, %zu active", session_count - 1, sessions.size());
+                }
+                continue;
+            }
+
+            const auto it = sessions.find(fd);
+            if (it == sessions.end()) {
+                continue;
+            }
+            const session_ptr session = it->second;
+            bool closed = false;
+            bool schedule = false;
+            for (;;) {
+                const ssize_t n = read(fd, buf.data(), buf.size());
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    closed = n == 0 || errno != EAGAIN;
+                    break;
+                }
+                const auto now = LatencyWatchdog::clock::now();
+                std::lock_guard<std::mutex> lock(session->mutex);
+                session->input.append(buf.data(), static_cast<size_t>(n));
+                session->received.insert(session->received.end(), std::count(buf.data(), buf.data() + n, '\n'), now);
+                if (!session->scheduled && session->input.find('\n') != std::string::npos) {
+                    session->scheduled = schedule = true;
+                }
+            }
+            if (schedule) {
+                pool.push(session);
+            }
+            if (closed) {
+                //Worker keeps its reference until queued input is processed
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+                sessions.erase(it);
+                LOG_INFO("Session %d: disconnected, %zu active", session->id, sessions.size());
+            }
+        }
+    }
+
+    LOG_INFO("Stopping, %d sessions served", session_count);
+    close(epoll_fd);
+    close(listen_fd);
+    unlink(socket_path);
+    return 0;
+}
+
+} // namespace session_server
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "logic/montecarlo.h"
+
+///Many matches in one process, for evaluation farm. Every connection to a unix socket is a session
+///speaking the same line protocol as stdin/stdout, with its own Strategy and chipmunk arena.
+///Sessions with pending input are processed by a pool of worker threads, one session by one worker
+///at a time, so throughput scales with cores instead of process count
+namespace session_server {
+
+///Serves until SIGINT or SIGTERM, returns process exit code. Every session Strategy is created with given options
+int run(const char *socket_path, int workers, bool pipelined, montecarlo::Engine engine);
+
+} // namespace session_server
@@ -12,8 +12,133 @@
 #include <cstring>
 #include <map>
 
+#ifdef ENABLE_PINNED_MEMORY
+#include <mutex>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 using namespace cp;
 
+//MARK: Page source
+
+namespace {
+
+#ifdef ENABLE_PINNED_MEMORY
+///Mapped on first allocation, enough for arenas and snapshot pools of a usual game
+constexpr size_t k_reserve_bytes = 16 * 1024 * 1024;
+///Step of growth once reserve is exhausted
+constexpr size_t k_grow_bytes = 2 * 1024 * 1024;
+///Transparent huge pages back aligned ranges only
+constexpr size_t k_huge_page_bytes = 2 * 1024 * 1024;
+#endif
+
+///Memory of arenas and snapshot buffers. Plain heap by default. With ENABLE_PINNED_MEMORY buffers are cut from
+///pre-faulted mappings advised for huge pages and locked, so the first ticks do not pay page faults and constant
+///snapshot copying misses TLB less. Mappings live until exit, freed buffers are reused by size. When mapping
+///fails, buffers come from heap from then on
+class PageSource {
+public:
+    static PageSource &instance() {
+        //Never destroyed, buffers of thread arenas are returned after static destructors
+        static auto *source = new PageSource();
+        return *source;
+    }
+
+    uint8_t *allocate(size_t bytes);
+
+    void deallocate(uint8_t *ptr, size_t bytes);
+
+private:
+#ifdef ENABLE_PINNED_MEMORY
+    ///False when memory could not be mapped
+    bool map(size_t bytes);
+
+    std::mutex mutex_;
+    bool heap_only_ = false;
+    uint8_t *next_ = nullptr;
+    uint8_t *end_ = nullptr;
+    std::map<size_t, std::vector<uint8_t *>> free_;
+#endif
+};
+
+#ifdef ENABLE_PINNED_MEMORY
+
+uint8_t *PageSource::allocate(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto it = free_.find(bytes); it != free_.end() && !it->second.empty()) {
+        uint8_t *ret = it->second.back();
+        it->second.pop_back();
+        return ret;
+    }
+    if (!heap_only_ && static_cast<size_t>(end_ - next_) < bytes) {
+        //Tail of the previous mapping is dropped, it is smaller than any arena
+        heap_only_ = !map(next_ ? std::max(bytes, k_grow_bytes) : std::max(bytes, k_reserve_bytes));
+    }
+    if (heap_only_) {
+        //Never freed, like mapped buffers it goes to free list and is reused
+        return new uint8_t[bytes];
+    }
+    uint8_t *ret = next_;
+    next_ += bytes;
+    return ret;
+}
+
+void PageSource::deallocate(uint8_t *ptr, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_[bytes].push_back(ptr);
+}
+
+bool PageSource::map(size_t bytes) {
+    bytes = (bytes + k_huge_page_bytes - 1) / k_huge_page_bytes * k_huge_page_bytes;
+    //Over-map to align start on huge page, the slack is unmapped
+    const size_t mapped = bytes + k_huge_page_bytes;
+    void *raw = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        //Log may be compiled out, so failure is handled here whatever the log configuration is
+        LOG_WARN("Cannot map %lu bytes for arenas, heap is used", mapped);
+        return false;
+    }
+    auto *begin = static_cast<uint8_t *>(raw);
+    auto *aligned = reinterpret_cast<uint8_t *>(
+        (reinterpret_cast<uintptr_t>(begin) + k_huge_page_bytes - 1) / k_huge_page_bytes * k_huge_page_bytes);
+    if (aligned > begin) {
+        munmap(begin, aligned - begin);
+    }
+    if (begin + mapped > aligned + bytes) {
+        munmap(aligned + bytes, begin + mapped - (aligned + bytes));
+    }
+
+    //Advice goes before the first touch, MAP_POPULATE would fault in small pages
+    [[maybe_unused]] const bool huge = madvise(aligned, bytes, MADV_HUGEPAGE) == 0;
+    const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t offset = 0; offset < bytes; offset += page) {
+        aligned[offset] = 0;
+    }
+    //Usually fails on default RLIMIT_MEMLOCK, memory is still faulted in
+    [[maybe_unused]] const bool locked = mlock(aligned, bytes) == 0;
+    LOG_INFO("Pinned memory: %lu KB, huge pages %s, locked %s", bytes / 1024, huge ? "advised" : "unavailable",
+             locked ? "yes" : "no");
+
+    next_ = aligned;
+    end_ = aligned + bytes;
+    return true;
+}
+
+#else
+
+uint8_t *PageSource::allocate(size_t bytes) {
+    return new uint8_t[bytes];
+}
+
+void PageSource::deallocate(uint8_t *ptr, size_t) {
+    delete[] ptr;
+}
+
+#endif
+
+} // anonymous namespace
+
 //MARK: Custom allocator
 
 class alloc_control_t {
@@ -21,6 +146,8 @@ public:
     friend class cp::Space;
 
     alloc_control_t();
+    alloc_control_t(const alloc_control_t &) = delete;
+    ~alloc_control_t();
 
     void *calloc(size_t nmemb, size_t size);
 
@@ -29,15 +156,16 @@ public:
     void free(void *ptr);
 
     inline size_t dump(void *ptr_to) {
-        std::memcpy(ptr_to, buffer_.get(), used_bytes_);
+        std::memcpy(ptr_to, buffer_, used_bytes_);
         return used_bytes_;
     }
 
-    inline void load(void *ptr_from, size_t bytes) {
-        std::memcpy(buffer_.get(), ptr_from, bytes);
+    inline void load(const void *ptr_from, size_t bytes) {
+        std::memcpy(buffer_, ptr_from, bytes);
         used_bytes_ = bytes;
     }
 
+
     void print_usage_statistics() const;
 
     size_t block_size() const {
@@ -84,13 +212,17 @@ private:
     }
 
     size_t used_bytes_ = 0;
-    std::unique_ptr<uint8_t[]>(buffer_);
+    uint8_t *buffer_;
 };
 
 alloc_control_t::alloc_control_t() {
     //One huge block
-    buffer_.reset(new uint8_t[ALLOC_BUF_SIZE]);
-    memset(buffer_.get(), 0, ALLOC_BUF_SIZE);
+    buffer_ = PageSource::instance().allocate(ALLOC_BUF_SIZE);
+    memset(buffer_, 0, ALLOC_BUF_SIZE);
+}
+
+alloc_control_t::~alloc_control_t() {
+    PageSource::instance().deallocate(buffer_, ALLOC_BUF_SIZE);
 }
 
 void *alloc_control_t::calloc(size_t nmemb, size_t size) {
@@ -165,39 +297,138 @@ void alloc_control_t::print_usage_statistics() const {
     LOG_DEBUG("alloc_control_t:: Block size %lu; Active memory %u", used_bytes_, active_memory_bytes);
 }
 
-alloc_control_t g_mm;
+namespace {
+
+///Own arena of the calling thread, so every thread can run its own Simulator
+///Arena holds raw pointers into itself, so snapshots are restored only into the arena which saved them
+thread_local alloc_control_t t_thread_arena;
+///Arena set by ArenaScope, thread one if null
+thread_local alloc_control_t *t_arena = nullptr;
+
+inline alloc_control_t &current_arena() {
+    return t_arena ? *t_arena : t_thread_arena;
+}
+
+} // anonymous namespace
 
 namespace cp {
 
+//MARK: Snapshot pool
+
+namespace {
+
+///Free buffers by count of pages, snapshots rarely cross threads, so no locking
+struct free_pages_t {
+    std::vector<uint8_t *> by_pages[ALLOC_BUF_SIZE / snapshot_buf_t::PAGE_SIZE + 1];
+
+    ~free_pages_t() {
+        for (size_t pages = 0; pages < std::size(by_pages); ++pages) {
+            for (auto *ptr : by_pages[pages]) {
+                PageSource::instance().deallocate(ptr, pages * snapshot_buf_t::PAGE_SIZE);
+            }
+        }
+    }
+};
+
+thread_local free_pages_t t_free_pages;
+
+} // anonymous namespace
+
+snapshot_buf_t::snapshot_buf_t(snapshot_buf_t &&other) noexcept
+    : data_(other.data_)
+    , capacity_(other.capacity_) {
+    other.data_ = nullptr;
+    other.capacity_ = 0;
+}
+
+snapshot_buf_t &snapshot_buf_t::operator=(snapshot_buf_t &&other) noexcept {
+    if (this != &other) {
+        release();
+        data_ = other.data_;
+        capacity_ = other.capacity_;
+        other.data_ = nullptr;
+        other.capacity_ = 0;
+    }
+    return *this;
+}
+
+snapshot_buf_t::~snapshot_buf_t() {
+    release();
+}
+
+uint8_t *snapshot_buf_t::reserve(size_t bytes) {
+    if (bytes <= capacity_) {
+        return data_;
+    }
+    assert(bytes <= ALLOC_BUF_SIZE);
+    release();
+
+    const size_t pages = (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    auto &free_list = t_free_pages.by_pages[pages];
+    if (!free_list.empty()) {
+        data_ = free_list.back();
+        free_list.pop_back();
+    } else {
+        data_ = PageSource::instance().allocate(pages * PAGE_SIZE);
+    }
+    capacity_ = pages * PAGE_SIZE;
+    return data_;
+}
+
+void snapshot_buf_t::release() {
+    if (data_) {
+        t_free_pages.by_pages[capacity_ / PAGE_SIZE].push_back(data_);
+        data_ = nullptr;
+        capacity_ = 0;
+    }
+}
+
 transaction_t::transaction_t() {
-    ptr.reset(new uint8_t[ALLOC_BUF_SIZE]);
     loose_state[0] = false;
     loose_state[1] = false;
 }
 
-size_t memdump(void *ptr_to) {
-    return g_mm.dump(ptr_to);
+size_t memdump(snapshot_buf_t &to) {
+    auto &arena = current_arena();
+    return arena.dump(to.reserve(arena.block_size()));
 }
 
-void memload(void *ptr_from, size_t bytes) {
-    g_mm.load(ptr_from, bytes);
+void memload(const snapshot_buf_t &from, size_t bytes) {
+    current_arena().load(from.get(), bytes);
 }
 
 void print_memory_usage() {
-    return g_mm.print_usage_statistics();
+    return current_arena().print_usage_statistics();
+}
+
+//MARK: Arena
+
+Arena::Arena()
+    : impl_(std::make_unique<alloc_control_t>()) {
+}
+
+Arena::~Arena() = default;
+
+ArenaScope::ArenaScope(Arena &arena)
+    : prev_(t_arena) {
+    t_arena = arena.impl_.get();
+}
+
+ArenaScope::~ArenaScope() {
+    t_arena = prev_;
 }
 } // namespace cp
 
 void *memento_calloc(size_t nmemb, size_t size) {
-    return g_mm.calloc(nmemb, size);
+    return current_arena().calloc(nmemb, size);
 }
 
 void *memento_realloc(void *ptr, size_t size) {
-    return g_mm.realloc(ptr, size);
+    return current_arena().realloc(ptr, size);
 }
 
 void memento_free(void *ptr) {
-    g_mm.free(ptr);
+    current_arena().free(ptr);
 }
 
 //MARK: Space
@@ -207,7 +438,7 @@ Space::Space() {
 }
 
 Space::~Space() {
-    g_mm.print_usage_statistics();
+    current_arena().print_usage_statistics();
     clear();
     cpSpaceFree(impl_);
 }
@@ -10,27 +10,88 @@
 #include <memory>
 #include <map>
 
+class alloc_control_t;
+
 namespace cp {
 
 ///Custom allocator memory management
 inline constexpr size_t ALLOC_BUF_SIZE = 256 * 1024;
 
+///Storage of arena snapshot, sized to what was dumped in it
+///Memory is recycled through a per thread pool of size classes, so snapshots of growing arena are cheap to resize
+class snapshot_buf_t {
+public:
+    ///Size class granularity
+    static constexpr size_t PAGE_SIZE = 4 * 1024;
+
+    snapshot_buf_t() = default;
+    snapshot_buf_t(const snapshot_buf_t &) = delete;
+    snapshot_buf_t(snapshot_buf_t &&other) noexcept;
+    snapshot_buf_t &operator=(snapshot_buf_t &&other) noexcept;
+    ~snapshot_buf_t();
+
+    ///At least bytes of storage, content is lost when buffer grows
+    uint8_t *reserve(size_t bytes);
+
+    uint8_t *get() const {
+        return data_;
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+private:
+    void release();
+
+    uint8_t *data_ = nullptr;
+    size_t capacity_ = 0;
+};
+
 struct transaction_t {
     transaction_t();
 
-    std::unique_ptr<uint8_t[]> ptr;
+    snapshot_buf_t ptr;
     size_t bytes;
     uint16_t ticks_to_deadline;
+    double deadline_mark;
     bool loose_state[2];
     bool in_air_state[2];
     int turn_idx;
 };
 
-size_t memdump(void *ptr_to);
-void memload(void *ptr_from, size_t bytes);
+///Raw copy of arena of the calling thread
+size_t memdump(snapshot_buf_t &to);
+void memload(const snapshot_buf_t &from, size_t bytes);
 
 void print_memory_usage();
 
+///Chipmunk memory of one simulation context. Every thread has an arena of its own, which is used
+///until ArenaScope makes another one current. Objects allocated in an arena, snapshots of it included,
+///are used only while it is current, so independent contexts can share a thread or move between threads
+class Arena {
+public:
+    Arena();
+    Arena(const Arena &) = delete;
+    ~Arena();
+
+private:
+    friend class ArenaScope;
+
+    std::unique_ptr<alloc_control_t> impl_;
+};
+
+///Makes arena current on the calling thread, previous one is restored at the scope end
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena &arena);
+    ArenaScope(const ArenaScope &) = delete;
+    ~ArenaScope();
+
+private:
+    alloc_control_t *prev_;
+};
+
 ///Thin wrapper over cpSpace
 ///It graps ownership of any shape, body or constraint
 class Space {
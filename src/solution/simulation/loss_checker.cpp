@@ -0,0 +1,163 @@
+#include "loss_checker.h"
+
+#include <chipmunk/chipmunk_structs.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+//Map box, the same one original server builds around the map
+constexpr double k_box_height = 10.0;
+constexpr double k_box_offset = k_box_height - 1.0;
+constexpr double k_box_max_height = 800.0;
+constexpr double k_box_max_width = 1200.0;
+
+inline int edge_count(const LossChecker::convex_t &c) {
+    return c.count < 3 ? c.count - 1 : c.count;
+}
+
+inline double point_segment_dist(vec2 p, vec2 a, vec2 b) {
+    const vec2 ab = b - a;
+    const double len2 = ab.len2();
+    const double t = len2 > 0.0 ? std::clamp(dot(p - a, ab) / len2, 0.0, 1.0) : 0.0;
+    return length(p - (a + ab * t));
+}
+
+inline void project(const LossChecker::convex_t &c, vec2 axis, double &lo, double &hi) {
+    lo = hi = dot(c.pts[0], axis);
+    for (int i = 1; i < c.count; ++i) {
+        const double d = dot(c.pts[i], axis);
+        lo = std::min(lo, d);
+        hi = std::max(hi, d);
+    }
+}
+
+///Largest gap between projections of convexes on edge normals of the first one
+inline double max_gap(const LossChecker::convex_t &c, const LossChecker::convex_t &a,
+                      const LossChecker::convex_t &b) {
+    double gap = -INF;
+    for (int i = 0; i < edge_count(c); ++i) {
+        const vec2 axis = normalize(rot90(c.pts[(i + 1) % c.count] - c.pts[i]));
+        double a_lo, a_hi, b_lo, b_hi;
+        project(a, axis, a_lo, a_hi);
+        project(b, axis, b_lo, b_hi);
+        gap = std::max(gap, std::max(b_lo - a_hi, a_lo - b_hi));
+    }
+    return gap;
+}
+
+///Distance from vertices of the first convex to edges of the second one
+inline double vertex_edge_dist(const LossChecker::convex_t &a, const LossChecker::convex_t &b) {
+    double dist = INF;
+    for (int i = 0; i < a.count; ++i) {
+        for (int j = 0; j < edge_count(b); ++j) {
+            dist = std::min(dist, point_segment_dist(a.pts[i], b.pts[j], b.pts[(j + 1) % b.count]));
+        }
+    }
+    return dist;
+}
+
+} // anonymous namespace
+
+void LossChecker::init(const Game *game) {
+    terrain_.clear();
+    terrain_.reserve(game->proto_map.size() + 4);
+
+    const double bo = k_box_offset;
+    const std::pair<vec2, vec2> boundaries[] = {
+        {{-bo,                   -bo},                    {-bo,                   k_box_max_height + bo}},
+        {{-bo,                   k_box_max_height + bo},  {k_box_max_width + bo,  k_box_max_height + bo}},
+        {{k_box_max_width + bo,  k_box_max_height + bo},  {k_box_max_width + bo,  -bo}},
+        {{k_box_max_width + bo,  -bo},                    {-bo,                   -bo}}
+    };
+    for (auto[b0, b1] : boundaries) {
+        terrain_.push_back(capsule(b0, b1, k_box_height));
+    }
+
+    for (const auto &seg : game->proto_map) {
+        terrain_.push_back(capsule(seg.p1, seg.p2, seg.height));
+    }
+}
+
+bool LossChecker::button_touches(const cpShape *button, double deadline_level,
+                                 const cpShape *const *enemy, int enemy_count) const {
+    const convex_t btn = world_convex(button);
+
+    //Deadline spans whole map width, so only the lowest vertex matters
+    if (btn.bb_min.y <= deadline_level) {
+        return true;
+    }
+
+    for (const auto &seg : terrain_) {
+        if (touches(btn, seg)) {
+            return true;
+        }
+    }
+
+    for (int i = 0; i < enemy_count; ++i) {
+        if (touches(btn, world_convex(enemy[i]))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+LossChecker::convex_t LossChecker::world_convex(const cpShape *shape) {
+    convex_t ret;
+    const cpBody *body = cpShapeGetBody(shape);
+
+    if (shape->klass->type == CP_POLY_SHAPE) {
+        ret.count = cpPolyShapeGetCount(shape);
+        assert(ret.count <= MAX_VERTS);
+        ret.radius = cpPolyShapeGetRadius(shape);
+        for (int i = 0; i < ret.count; ++i) {
+            ret.pts[i] = cpBodyLocalToWorld(body, cpPolyShapeGetVert(shape, i));
+        }
+    } else {
+        assert(shape->klass->type == CP_CIRCLE_SHAPE);
+        ret.count = 1;
+        ret.radius = cpCircleShapeGetRadius(shape);
+        ret.pts[0] = cpBodyLocalToWorld(body, cpCircleShapeGetOffset(shape));
+    }
+
+    ret.bb_min = ret.bb_max = ret.pts[0];
+    for (int i = 1; i < ret.count; ++i) {
+        ret.bb_min = {std::min(ret.bb_min.x, ret.pts[i].x), std::min(ret.bb_min.y, ret.pts[i].y)};
+        ret.bb_max = {std::max(ret.bb_max.x, ret.pts[i].x), std::max(ret.bb_max.y, ret.pts[i].y)};
+    }
+    return ret;
+}
+
+bool LossChecker::touches(const convex_t &poly, const convex_t &other) {
+    assert(poly.count >= 3);
+    const double r = poly.radius + other.radius;
+
+    if (poly.bb_min.x - r > other.bb_max.x || other.bb_min.x - r > poly.bb_max.x ||
+        poly.bb_min.y - r > other.bb_max.y || other.bb_min.y - r > poly.bb_max.y) {
+        return false;
+    }
+
+    //Separating axis: gap on any edge normal is a lower bound of the distance
+    const double gap = std::max(max_gap(poly, poly, other), max_gap(other, poly, other));
+    if (gap > r) {
+        return false;
+    }
+    if (gap <= 0.0) {
+        return true;
+    }
+
+    //Separated, but closer than radii on every axis, so check exact distance between boundaries
+    return std::min(vertex_edge_dist(poly, other), vertex_edge_dist(other, poly)) <= r;
+}
+
+LossChecker::convex_t LossChecker::capsule(vec2 a, vec2 b, double radius) {
+    convex_t ret;
+    ret.count = 2;
+    ret.radius = radius;
+    ret.pts[0] = a;
+    ret.pts[1] = b;
+    ret.bb_min = {std::min(a.x, b.x), std::min(a.y, b.y)};
+    ret.bb_max = {std::max(a.x, b.x), std::max(a.y, b.y)};
+    return ret;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../structures.h"
+
+#include <chipmunk/chipmunk.h>
+
+#include <vector>
+
+///Analytic replacement of sensor shapes for loss detection.
+///Button polygon is compared with deadline level and tested against terrain and enemy shapes with SAT,
+///which gives the same answer as sensor contact without running them through the collision pipeline.
+class LossChecker {
+public:
+    static constexpr int MAX_VERTS = 16;
+
+    ///Convex hull of shape points, inflated by radius
+    struct convex_t {
+        vec2 pts[MAX_VERTS];
+        int count = 0;
+        double radius = 0.0;
+        vec2 bb_min;
+        vec2 bb_max;
+    };
+
+    ///Builds terrain from map segments and map box boundaries
+    void init(const Game *game);
+
+    ///Whether button touches deadline, terrain or any of enemy shapes, all in their current positions.
+    ///Button shape is not required to be added to space, it only has to be attached to car body.
+    bool button_touches(const cpShape *button, double deadline_level,
+                        const cpShape *const *enemy, int enemy_count) const;
+
+    ///World space convex of polygon or circle shape
+    static convex_t world_convex(const cpShape *shape);
+
+    ///Whether convexes are closer than sum of their radii. First one should be a polygon
+    static bool touches(const convex_t &poly, const convex_t &other);
+
+private:
+    static convex_t capsule(vec2 a, vec2 b, double radius);
+
+    std::vector<convex_t> terrain_;
+};
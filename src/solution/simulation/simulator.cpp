@@ -3,19 +3,25 @@
 //
 
 #include "simulator.h"
+#include "state_hash.h"
 #include "../common/vis_debug.h"
 
 #include <chipmunk/chipmunk.h>
 
-cpBool callback_0(cpArbiter *, cpSpace *, cpDataPointer user_data) {
-    static_cast<NativeWorld *>(user_data)->cars[0].loosed = true;
-    return 1;
-};
+namespace {
 
-cpBool callback_1(cpArbiter *, cpSpace *, cpDataPointer user_data) {
-    static_cast<NativeWorld *>(user_data)->cars[1].loosed = true;
-    return 1;
-};
+//Deadline is a band of the whole map width, its top edge is this high above its position
+constexpr double k_deadline_top = 2.0;
+constexpr double k_deadline_start = 10.0;
+
+///Shape is kept in space, so spatial index and collision order are the same as on the original server,
+///but it never reaches narrow phase. Its contacts are found by LossChecker
+void make_inert(cpShape *shape) {
+    cpShapeSetSensor(shape, 1);
+    cpShapeSetFilter(shape, CP_SHAPE_FILTER_NONE);
+}
+
+} // anonymous namespace
 
 void Simulator::init(const Game *game) {
     game_ = game;
@@ -24,15 +30,6 @@ void Simulator::init(const Game *game) {
     cpSpaceSetGravity(space_.native(), {0.0, -700.0});
     cpSpaceSetDamping(space_.native(), 0.85);
 
-    handler_[0] = cpSpaceAddWildcardHandler(space_.native(), 20);
-    handler_[1] = cpSpaceAddWildcardHandler(space_.native(), 30);
-
-    handler_[0]->userData = &cur_w_native_;
-    handler_[0]->beginFunc = callback_0;
-
-    handler_[1]->userData = &cur_w_native_;
-    handler_[1]->beginFunc = callback_1;
-
     //Map box
     const double segment_height = 10;
     const double bo = segment_height - 1;
@@ -46,7 +43,7 @@ void Simulator::init(const Game *game) {
     };
     for (auto[b0, b1] : boundaries) {
         auto shape = cpSegmentShapeNew(space_.static_body(), b0, b1, segment_height);
-        cpShapeSetSensor(shape, 1);
+        make_inert(shape);
         space_.add_shape(shape);
     }
 
@@ -59,17 +56,19 @@ void Simulator::init(const Game *game) {
     }
 
     //Add deadline
+    loss_checker_.init(game_);
     ticks_to_deadline_ = TICK_TO_DEADLINE;
+    deadline_mark_ = k_deadline_start;
     if (deadline_.body) {
         cpBodyFree(deadline_.body);
     }
     deadline_.body = cpBodyNewKinematic();
     const cpVect deadline_pts[] = {
-        {0.0, 2.0}, {1200.0, 2.0}, {1200.0, -20.0}, {0.0, -20.0}
+        {0.0, k_deadline_top}, {1200.0, k_deadline_top}, {1200.0, -20.0}, {0.0, -20.0}
     };
     deadline_.shape = cpPolyShapeNew(deadline_.body, 4, deadline_pts, cpTransform{1, 0, 0, 1, 0, 0}, 0);
-    cpShapeSetSensor(deadline_.shape, 1);
-    cpBodySetPosition(deadline_.body, {0.0, 10.0});
+    make_inert(deadline_.shape);
+    cpBodySetPosition(deadline_.body, {0.0, deadline_mark_});
     space_.add_shape(deadline_.shape);
 }
 
@@ -123,13 +122,14 @@ void Simulator::step(Action my_action, Action enemy_action) {
     car_apply_action(1 - my_real_id_, enemy_action);
 
     if (ticks_to_deadline_ < 1) {
-        auto deadline_pos = cpBodyGetPosition(deadline_.body);
-        cpBodySetPosition(deadline_.body, deadline_pos + vec2{0, 0.5});
+        deadline_mark_ += 0.5;
+        cpBodySetPosition(deadline_.body, {0.0, deadline_mark_});
     } else {
         --ticks_to_deadline_;
     }
 
     cpSpaceStep(space_.native(), dt);
+    check_loss();
 
     cur_w_native_.cars[0].in_air = check_in_air(0);
     cur_w_native_.cars[1].in_air = check_in_air(1);
@@ -161,9 +161,9 @@ bool Simulator::check_in_air(int car_idx) const {
 }
 
 void Simulator::save(cp::transaction_t &to) {
-    auto bytes = cp::memdump(to.ptr.get());
-    to.bytes = bytes;
+    to.bytes = cp::memdump(to.ptr);
     to.ticks_to_deadline = ticks_to_deadline_;
+    to.deadline_mark = deadline_mark_;
     for (int i = 0; i < 2; ++i) {
         to.loose_state[i] = cur_w_native_.cars[i].loosed;
         to.in_air_state[i] = cur_w_native_.cars[i].in_air;
@@ -172,10 +172,10 @@ void Simulator::save(cp::transaction_t &to) {
 }
 
 void Simulator::restore(const cp::transaction_t &from) {
-    //TODO: It looks like deadline position restoration works wrong
-    cp::memload(from.ptr.get(), from.bytes);
+    cp::memload(from.ptr, from.bytes);
     ticks_to_deadline_ = from.ticks_to_deadline;
-    cur_w.deadline_mark = cpBodyGetPosition(deadline_.body).y;
+    deadline_mark_ = from.deadline_mark;
+    cur_w.deadline_mark = deadline_mark_;
     for (int i = 0; i < 2; ++i) {
         cur_w_native_.cars[i].loosed = from.loose_state[i];
         cur_w_native_.cars[i].in_air = from.in_air_state[i];
@@ -188,6 +188,18 @@ void Simulator::swap_sides() {
     my_real_id_ = 1 - my_real_id_;
 }
 
+cpSpace *Simulator::native_space() const {
+    return space_.native();
+}
+
+uint64_t Simulator::state_hash() const {
+    return cp::state_hash(space_.native());
+}
+
+bool Simulator::round_over() const {
+    return cur_w_native_.cars[0].loosed || cur_w_native_.cars[1].loosed;
+}
+
 Simulator::cp_car_t Simulator::create_car(const CarDescription &car, cpGroup car_group) {
     //Create car
     cp_car_t ret;
@@ -219,9 +231,7 @@ Simulator::cp_car_t Simulator::create_car(const CarDescription &car, cpGroup car
 
     ret.button = cpPolyShapeNew(ret.body, static_cast<int>(button_pts.size()), button_pts.data(),
                                 cpTransform{1, 0, 0, 1, 0, 0}, 0);
-    cpShapeSetFilter(ret.button, ret.filter);
-    cpShapeSetSensor(ret.button, 1);
-    cpShapeSetCollisionType(ret.button, car_group * 10);
+    make_inert(ret.button);
 
     cpBodySetCenterOfGravity(ret.body, cpShapeGetCenterOfGravity(ret.shape));
 
@@ -339,7 +349,7 @@ void Simulator::update_world() const {
     world_changed_ = false;
 
     if (ticks_to_deadline_ < 1) {
-        cur_w.deadline_mark = cpBodyGetPosition(deadline_.body).y;
+        cur_w.deadline_mark = deadline_mark_;
     }
 
     for (int i = 0; i < 2; ++i) {
@@ -352,3 +362,17 @@ void Simulator::update_world() const {
         car.rear_wheel.angle = cpBodyGetAngle(cars_[i].rear_wheel.body);
     }
 }
+
+void Simulator::check_loss() {
+    //Sensors reported the first contact only, so loss stays until restore
+    for (int i = 0; i < 2; ++i) {
+        if (cur_w_native_.cars[i].loosed) {
+            continue;
+        }
+        const cp_car_t &enemy = cars_[1 - i];
+        const cpShape *enemy_shapes[] = {enemy.shape, enemy.button, enemy.rear_wheel.shape, enemy.front_wheel.shape};
+        cur_w_native_.cars[i].loosed = loss_checker_.button_touches(
+            cars_[i].button, deadline_mark_ + k_deadline_top, enemy_shapes, 4
+        );
+    }
+}
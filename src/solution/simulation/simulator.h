@@ -6,6 +6,7 @@
 
 #include "../structures.h"
 #include "cp_helpers.h"
+#include "loss_checker.h"
 
 #include <chipmunk/chipmunk.h>
 #include <chipmunk/chipmunk_structs.h>
@@ -69,6 +70,15 @@ public:
     ///Swap me and enemy for action simulation
     void swap_sides();
 
+    ///Underlying chipmunk space, for offline tools
+    cpSpace *native_space() const;
+
+    ///Any of cars has lost, there is no sense to simulate further
+    bool round_over() const;
+
+    ///Canonical hash of physics state, see cp::state_hash
+    uint64_t state_hash() const;
+
 private:
     struct cp_wheel_t {
         cpBody *body;
@@ -81,6 +91,7 @@ private:
     struct cp_car_t {
         cpBody *body;
         cpShape *shape;
+        ///Inert shape, contacts are found by LossChecker
         cpShape *button;
         cpShapeFilter filter;
         cp_wheel_t front_wheel;
@@ -106,6 +117,8 @@ private:
 
     void update_world() const;
 
+    void check_loss();
+
     const Game *game_ = nullptr;
     mutable World cur_w;
     mutable bool world_changed_ = false;
@@ -113,7 +126,9 @@ private:
     int my_real_id_ = 0;
 
     cp::Space space_;
+    LossChecker loss_checker_;
     cp_deadline_t deadline_;
+    double deadline_mark_;
     uint16_t ticks_to_deadline_;
     cp_car_t cars_[2];
 
@@ -121,6 +136,4 @@ private:
     double saved_deadline_mark_;
     uint16_t saved_ticks_to_deadline_;
     size_t full_save_ticks_to_deadline_;
-
-    cpCollisionHandler *handler_[2];
 };
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "snapshot_ring.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using namespace cp;
+
+namespace {
+
+inline size_t word_count(size_t bytes) {
+    return (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+}
+
+} // anonymous namespace
+
+SnapshotRing::SnapshotRing(int capacity)
+    : entries_(static_cast<size_t>(capacity))
+    //Live states reference at most this many keyframes
+    , keyframes_(static_cast<size_t>(capacity / KEYFRAME_INTERVAL + 2)) {
+    assert(capacity > 0);
+}
+
+void SnapshotRing::clear() {
+    pushed_ = 0;
+    size_ = 0;
+}
+
+void SnapshotRing::push(const transaction_t &state) {
+    const auto *words = reinterpret_cast<const uint64_t *>(state.ptr.get());
+    const size_t count = word_count(state.bytes);
+    assert(count * sizeof(uint64_t) <= ALLOC_BUF_SIZE);
+
+    if (pushed_ % KEYFRAME_INTERVAL == 0) {
+        auto &key = keyframes_[(pushed_ / KEYFRAME_INTERVAL) % keyframes_.size()];
+        key.words.assign(words, words + count);
+    }
+    const auto &key = keyframe_of(pushed_);
+
+    auto &entry = entries_[pushed_ % entries_.size()];
+    entry.bytes = state.bytes;
+    entry.ticks_to_deadline = state.ticks_to_deadline;
+    entry.deadline_mark = state.deadline_mark;
+    for (int i = 0; i < 2; ++i) {
+        entry.loose_state[i] = state.loose_state[i];
+        entry.in_air_state[i] = state.in_air_state[i];
+    }
+    entry.turn_idx = state.turn_idx;
+
+    //Keyframe is treated as zero padded past its end
+    entry.delta.clear();
+    size_t i = 0;
+    while (i < count) {
+        const size_t skip_from = i;
+        while (i < count && i < key.words.size() && words[i] == key.words[i]) {
+            ++i;
+        }
+        if (i == count) {
+            break;
+        }
+        const size_t copy_from = i;
+        while (i < count && (i >= key.words.size() || words[i] != key.words[i])) {
+            ++i;
+        }
+        entry.delta.push_back((uint64_t(copy_from - skip_from) << 32) | (i - copy_from));
+        entry.delta.insert(entry.delta.end(), words + copy_from, words + i);
+    }
+
+    ++pushed_;
+    size_ = std::min(size_ + 1, static_cast<int>(entries_.size()));
+}
+
+void SnapshotRing::drop(int count) {
+    assert(count >= 0 && count <= size_);
+    pushed_ -= count;
+    size_ -= count;
+}
+
+int SnapshotRing::size() const {
+    return size_;
+}
+
+void SnapshotRing::get(int age, transaction_t &to) const {
+    assert(age >= 0 && age < size_);
+    const int64_t idx = pushed_ - 1 - age;
+    const auto &entry = entries_[idx % entries_.size()];
+    const auto &key = keyframe_of(idx);
+
+    const size_t count = word_count(entry.bytes);
+    auto *words = reinterpret_cast<uint64_t *>(to.ptr.reserve(count * sizeof(uint64_t)));
+    const size_t key_count = std::min(count, key.words.size());
+    std::memcpy(words, key.words.data(), key_count * sizeof(uint64_t));
+    std::fill(words + key_count, words + count, 0);
+
+    size_t pos = 0;
+    for (auto it = entry.delta.begin(); it != entry.delta.end();) {
+        pos += *it >> 32;
+        const size_t copy = *it & 0xffffffffu;
+        ++it;
+        std::copy(it, it + copy, words + pos);
+        it += copy;
+        pos += copy;
+    }
+
+    to.bytes = entry.bytes;
+    to.ticks_to_deadline = entry.ticks_to_deadline;
+    to.deadline_mark = entry.deadline_mark;
+    for (int i = 0; i < 2; ++i) {
+        to.loose_state[i] = entry.loose_state[i];
+        to.in_air_state[i] = entry.in_air_state[i];
+    }
+    to.turn_idx = entry.turn_idx;
+}
+
+const SnapshotRing::keyframe_t &SnapshotRing::keyframe_of(int64_t idx) const {
+    return keyframes_[(idx / KEYFRAME_INTERVAL) % keyframes_.size()];
+}
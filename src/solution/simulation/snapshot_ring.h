@@ -0,0 +1,58 @@
+#pragma once
+
+#include "cp_helpers.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace cp {
+
+///History of last states saved by Simulator::save
+///Every KEYFRAME_INTERVAL-th state is stored as is, others only keep words which differ from their keyframe,
+///so any state is restored by a keyframe copy and a single delta pass
+class SnapshotRing {
+public:
+    static constexpr int KEYFRAME_INTERVAL = 8;
+
+    explicit SnapshotRing(int capacity);
+
+    void clear();
+
+    ///Store state as the newest one, the oldest is dropped when ring is full
+    void push(const transaction_t &state);
+
+    ///Forget count newest states, e.g. before saving them again after re-simulation
+    void drop(int count);
+
+    ///Count of states available
+    int size() const;
+
+    ///Decode state saved age pushes ago, 0 - the newest one
+    void get(int age, transaction_t &to) const;
+
+private:
+    struct keyframe_t {
+        std::vector<uint64_t> words;
+    };
+
+    struct entry_t {
+        ///Runs of (skip << 32 | copy) header followed by copy words
+        std::vector<uint64_t> delta;
+        size_t bytes = 0;
+        uint16_t ticks_to_deadline = 0;
+        double deadline_mark = 0.0;
+        bool loose_state[2] = {false, false};
+        bool in_air_state[2] = {false, false};
+        int turn_idx = 0;
+    };
+
+    const keyframe_t &keyframe_of(int64_t idx) const;
+
+    std::vector<entry_t> entries_;
+    std::vector<keyframe_t> keyframes_;
+    ///Total count of pushes, index of the next state
+    int64_t pushed_ = 0;
+    int size_ = 0;
+};
+
+} // namespace cp
@@ -0,0 +1,94 @@
+#include "state_hash.h"
+
+#include <chipmunk/chipmunk_structs.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using namespace cp;
+
+namespace {
+
+constexpr int k_max_arbiters = 64;
+constexpr const char *k_contact_fields[CP_MAX_CONTACTS_PER_ARBITER][2] = {
+    {"contact0.jnAcc", "contact0.jtAcc"},
+    {"contact1.jnAcc", "contact1.jtAcc"},
+};
+
+///Arbiters are kept in order of collision detection, which depends on spatial index internals
+int sorted_arbiters(const cpSpace *space, const cpArbiter **out) {
+    const int count = std::min(space->arbiters->num, k_max_arbiters);
+    for (int i = 0; i < count; ++i) {
+        out[i] = static_cast<const cpArbiter *>(space->arbiters->arr[i]);
+    }
+    const auto key = [](const cpArbiter *arb) {
+        const cpHashValue a = arb->a->hashid;
+        const cpHashValue b = arb->b->hashid;
+        return std::make_pair(std::min(a, b), std::max(a, b));
+    };
+    std::sort(out, out + count, [&key](const cpArbiter *l, const cpArbiter *r) {
+        return key(l) < key(r);
+    });
+    return count;
+}
+
+///Calls visit(group, index, field, value) for every scalar of canonical state
+template<typename Visitor>
+void visit_state(const cpSpace *space, Visitor &&visit) {
+    const cpArray *bodies = space->dynamicBodies;
+    for (int i = 0; i < bodies->num; ++i) {
+        const auto *body = static_cast<const cpBody *>(bodies->arr[i]);
+        //@formatter:off
+        visit("body", i, "p.x", body->p.x);
+        visit("body", i, "p.y", body->p.y);
+        visit("body", i, "v.x", body->v.x);
+        visit("body", i, "v.y", body->v.y);
+        visit("body", i, "a",   body->a);
+        visit("body", i, "w",   body->w);
+        visit("body", i, "f.x", body->f.x);
+        visit("body", i, "f.y", body->f.y);
+        visit("body", i, "t",   body->t);
+        //@formatter:on
+    }
+
+    const cpArray *constraints = space->constraints;
+    for (int i = 0; i < constraints->num; ++i) {
+        auto *constraint = static_cast<cpConstraint *>(constraints->arr[i]);
+        visit("constraint", i, "impulse", cpConstraintGetImpulse(constraint));
+    }
+
+    const cpArbiter *arbiters[k_max_arbiters];
+    const int arbiter_count = sorted_arbiters(space, arbiters);
+    for (int i = 0; i < arbiter_count; ++i) {
+        const cpArbiter *arb = arbiters[i];
+        visit("arbiter", i, "shapes", static_cast<double>(std::min(arb->a->hashid, arb->b->hashid) << 16 |
+                                                          std::max(arb->a->hashid, arb->b->hashid)));
+        visit("arbiter", i, "n.x", arb->n.x);
+        visit("arbiter", i, "n.y", arb->n.y);
+        assert(arb->count <= CP_MAX_CONTACTS_PER_ARBITER);
+        for (int c = 0; c < arb->count; ++c) {
+            visit("arbiter", i, k_contact_fields[c][0], arb->contacts[c].jnAcc);
+            visit("arbiter", i, k_contact_fields[c][1], arb->contacts[c].jtAcc);
+        }
+    }
+}
+
+} // anonymous namespace
+
+uint64_t cp::state_hash(const cpSpace *space) {
+    uint64_t hash = 0;
+    visit_state(space, [&hash](const char *, int, const char *, double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        hash = chain_hash(hash, bits);
+    });
+    return hash;
+}
+
+void cp::state_fields(const cpSpace *space, std::vector<state_field_t> &out) {
+    out.clear();
+    visit_state(space, [&out](const char *group, int index, const char *field, double value) {
+        out.push_back({std::string(group) + "[" + std::to_string(index) + "]." + field, value});
+    });
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chipmunk/chipmunk.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cp {
+
+///Named scalar of physics state, e.g. body[2].v.x
+struct state_field_t {
+    std::string name;
+    double value;
+};
+
+///Hash of canonical physics state: dynamic bodies in creation order, constraint impulses
+///and arbiter contacts ordered by shape ids. Doubles are hashed bit exact, so any difference in
+///floating point evaluation changes it. No allocations, cheap enough to be taken every tick
+uint64_t state_hash(const cpSpace *space);
+
+///The same state as state_hash takes, as named fields to find which one differs
+void state_fields(const cpSpace *space, std::vector<state_field_t> &out);
+
+///Order dependent combination of per tick hashes. Once runs diverge, chains stay different,
+///so first divergent tick can be found by bisection
+inline uint64_t chain_hash(uint64_t prev, uint64_t hash) {
+    uint64_t z = prev * 0x9E3779B97F4A7C15ull + hash;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+} // namespace cp
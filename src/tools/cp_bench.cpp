@@ -0,0 +1,259 @@
+// Microbenchmarks of chipmunk kernels on real match geometry. World is built by Simulator from recorded
+// games (latest-game.txt format), advanced a few ticks to get resting contacts, and then each kernel is
+// timed in isolation from the same snapshot. Reported time is per single kernel call.
+//
+// Usage: cp-bench [-w warmup_ticks] [-s samples] game.txt [game.txt ...]
+//
+// Inputs may be json or binary replays, see replay-convert.
+//
+
+#include "../solution/common/replay.h"
+#include "../solution/simulation/simulator.h"
+#include "../solution/simulation/cp_helpers.h"
+#include "../solution/structures.h"
+
+extern "C" {
+#include <chipmunk/chipmunk_private.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+unsigned int RANDOM_SEED = 42;
+
+namespace {
+
+struct config_t {
+    int warmup_ticks = 90;
+    int samples = 21;
+};
+
+struct stats_t {
+    double median_ns;
+    double min_ns;
+    double mad_ns;
+    long calls;
+};
+
+///Time batch of calls_per_batch kernel calls, batch size is grown until it runs at least 1ms
+///Statistics are over samples batches, median and median absolute deviation are robust to scheduler noise
+stats_t measure(const std::function<void()> &batch, int calls_per_batch, int samples) {
+    using clock = std::chrono::steady_clock;
+    const auto run = [&batch](long repeats) {
+        const auto start = clock::now();
+        for (long i = 0; i < repeats; ++i) {
+            batch();
+        }
+        return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    };
+
+    long repeats = 1;
+    while (run(repeats) < 1e6 && repeats < (1L << 24)) {
+        repeats *= 2;
+    }
+
+    std::vector<double> per_call(static_cast<size_t>(samples));
+    for (auto &v : per_call) {
+        v = run(repeats) / (repeats * calls_per_batch);
+    }
+    std::sort(per_call.begin(), per_call.end());
+    const double median = per_call[per_call.size() / 2];
+
+    std::vector<double> dev;
+    dev.reserve(per_call.size());
+    for (double v : per_call) {
+        dev.push_back(std::abs(v - median));
+    }
+    std::sort(dev.begin(), dev.end());
+
+    return {median, per_call.front(), dev[dev.size() / 2], repeats * calls_per_batch};
+}
+
+void report(const std::string &name, int count, const stats_t &s) {
+    printf("  %-32s %4d %10.1f %10.1f %8.1f\n", name.c_str(), count, s.median_ns, s.min_ns, s.mad_ns);
+}
+
+const char *shape_type_name(const cpShape *shape) {
+    switch (shape->klass->type) {
+        case CP_CIRCLE_SHAPE: return "circle";
+        case CP_SEGMENT_SHAPE: return "segment";
+        case CP_POLY_SHAPE: return "poly";
+        default: return "unknown";
+    }
+}
+
+cpCollisionID reindex_noop(void *, void *, cpCollisionID id, void *data) {
+    ++*static_cast<int *>(data);
+    return id;
+}
+
+void bench_position(const replay::round_t &pos, const config_t &config) {
+    Simulator sim;
+    sim.init(&pos.game);
+    sim.set_world(pos.worlds[0]);
+    for (int i = 0; i < config.warmup_ticks; ++i) {
+        sim.step(Action::STOP, Action::STOP);
+    }
+
+    cp::transaction_t snapshot;
+    sim.save(snapshot);
+    cpSpace *space = sim.native_space();
+    const double dt = 0.016;
+
+    printf("map %d car %d after %d ticks\n", pos.game.proto_map_external_id, pos.game.proto_car.external_id,
+           config.warmup_ticks);
+    printf("  %-32s %4s %10s %10s %8s\n", "kernel", "n", "median,ns", "min,ns", "mad,ns");
+
+    //cpCollide per shape pair type, only pairs which pass broadphase and filtering
+    std::vector<cpShape *> shapes;
+    cpSpaceEachShape(space, [](cpShape *shape, void *data) {
+        static_cast<std::vector<cpShape *> *>(data)->push_back(shape);
+    }, &shapes);
+
+    struct pair_t {
+        cpShape *a;
+        cpShape *b;
+        cpCollisionID id;
+    };
+    std::map<std::string, std::vector<pair_t>> pairs;
+    for (size_t i = 0; i < shapes.size(); ++i) {
+        for (size_t j = i + 1; j < shapes.size(); ++j) {
+            cpShape *a = shapes[i];
+            cpShape *b = shapes[j];
+            if (a->body == b->body || !cpBBIntersects(a->bb, b->bb) || cpShapeFilterReject(a->filter, b->filter)) {
+                continue;
+            }
+            if (a->klass->type > b->klass->type) {
+                std::swap(a, b);
+            }
+            pairs[std::string(shape_type_name(a)) + "-" + shape_type_name(b)].push_back({a, b, 0});
+        }
+    }
+
+    struct cpContact contacts[CP_MAX_CONTACTS_PER_ARBITER];
+    for (auto &[name, list] : pairs) {
+        //Warm separating axis cache the same way cached arbiters do
+        for (auto &p : list) {
+            p.id = cpCollide(p.a, p.b, p.id, contacts).id;
+        }
+        auto stats = measure([&list, &contacts] {
+            for (auto &p : list) {
+                p.id = cpCollide(p.a, p.b, p.id, contacts).id;
+            }
+        }, static_cast<int>(list.size()), config.samples);
+        report("cpCollide " + name, static_cast<int>(list.size()), stats);
+    }
+
+    //Solver kernels change velocities and accumulated impulses, but keep the same shape of work
+    const int arbiters_cnt = space->arbiters->num;
+    if (arbiters_cnt > 0) {
+        auto stats = measure([space] {
+            cpArray *arbiters = space->arbiters;
+            for (int i = 0; i < arbiters->num; ++i) {
+                cpArbiterApplyImpulse(static_cast<cpArbiter *>(arbiters->arr[i]));
+            }
+        }, arbiters_cnt, config.samples);
+        report("cpArbiterApplyImpulse", arbiters_cnt, stats);
+        sim.restore(snapshot);
+    }
+
+    std::map<std::string, std::vector<cpConstraint *>> constraints;
+    for (int i = 0; i < space->constraints->num; ++i) {
+        auto *constraint = static_cast<cpConstraint *>(space->constraints->arr[i]);
+        const char *name = cpConstraintIsGrooveJoint(constraint) ? "groove joint"
+                           : cpConstraintIsDampedSpring(constraint) ? "damped spring"
+                           : cpConstraintIsSimpleMotor(constraint) ? "simple motor"
+                           : "other";
+        constraints[name].push_back(constraint);
+    }
+    for (auto &[name, list] : constraints) {
+        auto stats = measure([&list, dt] {
+            for (cpConstraint *c : list) {
+                c->klass->applyImpulse(c, dt);
+            }
+        }, static_cast<int>(list.size()), config.samples);
+        report("applyImpulse " + name, static_cast<int>(list.size()), stats);
+    }
+    sim.restore(snapshot);
+
+    {
+        int pairs_found = 0;
+        auto stats = measure([space, &pairs_found] {
+            cpSpatialIndexReindexQuery(space->dynamicShapes, reindex_noop, &pairs_found);
+        }, 1, config.samples);
+        report("cpBBTreeReindexQuery", 1, stats);
+        sim.restore(snapshot);
+    }
+
+    {
+        //The same queries as in-air check of both cars
+        std::vector<std::pair<cpVect, cpShapeFilter>> queries;
+        for (int i = 0; i < 2; ++i) {
+            cpBody *car = sim.world_native().cars[i].body;
+            CP_BODY_FOREACH_CONSTRAINT(car, constraint) {
+                //Every wheel hangs on a groove joint of the car body
+                if (!cpConstraintIsGrooveJoint(constraint)) {
+                    continue;
+                }
+                cpBody *wheel = cpConstraintGetBodyB(constraint);
+                queries.emplace_back(cpBodyGetPosition(wheel), wheel->shapeList->filter);
+            }
+        }
+        const double radius = pos.game.proto_car.rear_wheel.radius + 1;
+        auto stats = measure([space, &queries, radius] {
+            for (const auto &q : queries) {
+                cpSpacePointQueryNearest(space, q.first, radius, q.second, nullptr);
+            }
+        }, static_cast<int>(queries.size()), config.samples);
+        report("cpSpacePointQueryNearest", static_cast<int>(queries.size()), stats);
+    }
+
+    {
+        cp::transaction_t buf;
+        size_t bytes = 0;
+        auto dump = measure([&buf, &bytes] {
+            bytes = cp::memdump(buf.ptr);
+        }, 1, config.samples);
+        report("cp::memdump " + std::to_string(bytes / 1024) + "KB", 1, dump);
+
+        auto load = measure([&buf, bytes] {
+            cp::memload(buf.ptr, bytes);
+        }, 1, config.samples);
+        report("cp::memload", 1, load);
+    }
+    printf("\n");
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+    config_t config;
+    std::vector<replay::round_t> positions;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && !strcmp(argv[i], "-w")) {
+            config.warmup_ticks = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-s")) {
+            config.samples = std::max(1, atoi(argv[++i]));
+        } else {
+            if (!replay::read_start_positions(argv[i], positions)) {
+                fprintf(stderr, "Cannot read %s\n", argv[i]);
+            }
+        }
+    }
+
+    std::set<std::pair<int, int>> seen;
+    for (const auto &pos : positions) {
+        if (seen.insert({pos.game.proto_map_external_id, pos.game.proto_car.external_id}).second) {
+            bench_position(pos, config);
+        }
+    }
+    return 0;
+}
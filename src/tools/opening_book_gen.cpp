@@ -0,0 +1,155 @@
+// Offline opening book generator. Reads recorded games (latest-game.txt format), takes start position
+// of every round and plays it with deep search on both sides. Start positions are searched by worker
+// threads, each position in a chipmunk arena of its own.
+// Output is opening_book.inc content, one line per map, car and side.
+//
+// Usage: opening-book-gen [-t ticks] [-m mutations] [-j jobs] game.txt [game.txt ...]
+//
+// Inputs may be json or binary replays, see replay-convert.
+//
+
+#include "../solution/common/replay.h"
+#include "../solution/logic/montecarlo.h"
+#include "../solution/logic/evaluator.h"
+#include "../solution/logic/opening_book.h"
+#include "../solution/simulation/simulator.h"
+#include "../solution/structures.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+unsigned int RANDOM_SEED = 42;
+
+namespace {
+
+struct config_t {
+    int ticks = 60;
+    int mutations = 1000;
+    int jobs = 1;
+};
+
+using montecarlo::Genome;
+
+///Self play from start position with random streams of its index, returns book lines for my and enemy side
+std::string search_position(const replay::round_t &pos, const config_t &config, uint64_t stream) {
+    cp::Arena arena;
+    cp::ArenaScope scope(arena);
+    Simulator sim;
+    sim.init(&pos.game);
+    sim.set_world(pos.worlds[0]);
+    const Evaluator evaluator(pos.game, sim);
+
+    rand_stream_t my_rng(RANDOM_SEED, stream * 2);
+    rand_stream_t enemy_rng(RANDOM_SEED, stream * 2 + 1);
+    Genome me(&evaluator, &my_rng, true);
+    Genome enemy(&evaluator, &enemy_rng, true);
+    montecarlo::BatchScorer<Genome> scorer;
+    cp::transaction_t buf;
+
+    std::string my_line;
+    std::string enemy_line;
+    const int ticks = config.ticks - config.ticks % Genome::TURN_LEN;
+    for (int tick = 0; tick < ticks; ++tick) {
+        if (tick > 0) {
+            me.shift();
+            enemy.shift();
+        }
+        if (tick % Genome::TURN_LEN == 0) {
+            sim.save(buf);
+
+            sim.swap_sides();
+            scorer.reset(sim, buf, me);
+            montecarlo::hill_climb(&enemy, scorer, config.mutations, true);
+            sim.swap_sides();
+
+            scorer.reset(sim, buf, enemy);
+            montecarlo::hill_climb(&me, scorer, config.mutations, true);
+        }
+
+        my_line += OpeningBook::encode(me.get_action());
+        enemy_line += OpeningBook::encode(enemy.get_action());
+        sim.step(me.get_action(), enemy.get_action());
+
+        const auto &native = sim.world_native();
+        if (native.cars[0].loosed || native.cars[1].loosed) {
+            break;
+        }
+    }
+    //Book line should end on search boundary, so strategy starts its own search right after it
+    const size_t len = my_line.size() - my_line.size() % Genome::TURN_LEN;
+
+    const int map_id = pos.game.proto_map_external_id;
+    const int car_id = pos.game.proto_car.external_id;
+    char head[64];
+    std::string ret;
+    snprintf(head, sizeof(head), "{%d, %d, %d, \"", map_id, car_id, pos.worlds[0].me().x_modification);
+    ret += head + my_line.substr(0, len) + "\"},\n";
+    snprintf(head, sizeof(head), "{%d, %d, %d, \"", map_id, car_id, pos.worlds[0].enemy().x_modification);
+    ret += head + enemy_line.substr(0, len) + "\"},\n";
+    return ret;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+    config_t config;
+    config.jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<replay::round_t> positions;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && !strcmp(argv[i], "-t")) {
+            config.ticks = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-m")) {
+            config.mutations = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-j")) {
+            config.jobs = std::max(1, atoi(argv[++i]));
+        } else {
+            if (!replay::read_start_positions(argv[i], positions)) {
+                fprintf(stderr, "Cannot read %s\n", argv[i]);
+            }
+        }
+    }
+
+    //Start position depends on map and car only, both sides are generated from it
+    std::set<std::pair<int, int>> seen;
+    std::vector<const replay::round_t *> unique;
+    for (const auto &pos : positions) {
+        auto key = std::make_pair(pos.game.proto_map_external_id, pos.game.proto_car.external_id);
+        if (seen.insert(key).second) {
+            unique.push_back(&pos);
+        }
+    }
+    fprintf(stderr, "%zu start positions, %d ticks, %d mutations, %d jobs\n",
+            unique.size(), config.ticks, config.mutations, config.jobs);
+
+    std::vector<std::string> results(unique.size());
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < std::min<int>(config.jobs, static_cast<int>(unique.size())); ++i) {
+        workers.emplace_back([&] {
+            for (size_t p = next++; p < unique.size(); p = next++) {
+                results[p] = search_position(*unique[p], config, p);
+                fprintf(stderr, "position %zu done\n", p);
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    printf("// Generated by tools/opening_book_gen: %d ticks, %d mutations per search\n",
+           config.ticks, config.mutations);
+    printf("// {map_id, car_id, x_modification, \"<L|R|S per tick>\"},\n");
+    for (const auto &line : results) {
+        fputs(line.c_str(), stdout);
+    }
+    return 0;
+}
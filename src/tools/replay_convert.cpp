@@ -0,0 +1,74 @@
+// Converts json replays (latest-game.txt format) to a single binary replay, matches of all inputs
+// are stored one after another. Binary replay is accepted by the strategy itself and by offline tools.
+//
+// Usage: replay-convert -o corpus.bin game.txt [game.txt ...]
+//
+
+#include "../solution/common/replay.h"
+#include "../solution/structures.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+unsigned int RANDOM_SEED = 42;
+
+namespace {
+
+///Returns count of ticks written, -1 if file cannot be read
+int convert(const char *path, replay::Writer &writer, int &matches) {
+    std::vector<replay::round_t> rounds;
+    if (!replay::read_rounds(path, rounds)) {
+        return -1;
+    }
+
+    int ticks = 0;
+    for (const auto &round : rounds) {
+        writer.begin_match(round.game);
+        for (const auto &world : round.worlds) {
+            writer.add_tick(world);
+        }
+        ticks += static_cast<int>(round.worlds.size());
+    }
+    matches += static_cast<int>(rounds.size());
+    return ticks;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+    const char *out = nullptr;
+    int first_input = 1;
+    if (argc > 2 && !strcmp(argv[1], "-o")) {
+        out = argv[2];
+        first_input = 3;
+    }
+    if (!out || first_input >= argc) {
+        fprintf(stderr, "Usage: %s -o corpus.bin game.txt [game.txt ...]\n", argv[0]);
+        return 1;
+    }
+
+    replay::Writer writer(out);
+    if (!writer.ok()) {
+        fprintf(stderr, "Cannot create %s\n", out);
+        return 1;
+    }
+
+    int matches = 0;
+    int ticks = 0;
+    for (int i = first_input; i < argc; ++i) {
+        const int converted = convert(argv[i], writer, matches);
+        if (converted < 0) {
+            fprintf(stderr, "Cannot open %s\n", argv[i]);
+            continue;
+        }
+        ticks += converted;
+    }
+
+    if (!writer.ok()) {
+        fprintf(stderr, "Write to %s failed\n", out);
+        return 1;
+    }
+    printf("%d matches, %d ticks written to %s\n", matches, ticks, out);
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Summary of search.trace written by the strategy built with ENABLE_SEARCH_TRACE (see logic/search_trace.h).
+// For every side and phase of hill climbing prints acceptance rate, score gain of accepted children and
+// gain per simulated level, then acceptance by index of mutation in climb and by genome position mutated.
+// Indexes which are rarely accepted are the budget to cut or move elsewhere.
+//
+// Usage: search-trace-summary [-b bucket] search.trace [search.trace ...]
+//
+//   -b  mutation indexes per row of by-index table, default 5
+//
+
+#include "../solution/logic/search_trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace search_trace;
+
+namespace {
+
+constexpr int k_sides = 2;
+constexpr int k_phases = 3;
+constexpr int k_max_positions = 32;
+constexpr const char *k_side_names[k_sides] = {"me", "enemy"};
+constexpr const char *k_phase_names[k_phases] = {"strong", "medium", "fine"};
+
+struct stat_t {
+    long mutations = 0;
+    long accepted = 0;
+    double gain = 0.0;
+    long levels = 0;
+
+    void add(const mutation_t &m) {
+        ++mutations;
+        levels += m.levels;
+        if (m.accepted) {
+            ++accepted;
+            gain += m.child_score - m.parent_score;
+        }
+    }
+
+    double rate() const {
+        return mutations ? 100.0 * accepted / mutations : 0.0;
+    }
+};
+
+struct summary_t {
+    long climbs[k_sides] = {};
+    stat_t by_phase[k_sides][k_phases];
+    std::vector<stat_t> by_index[k_sides];
+    stat_t by_position[k_sides][k_max_positions];
+    int depth[k_sides] = {};
+};
+
+bool read_trace(const char *path, summary_t &summary) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+    file_header_t header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, MAGIC, sizeof(MAGIC))
+        || header.version != VERSION) {
+        fprintf(stderr, "%s is not a search trace of version %u\n", path, VERSION);
+        fclose(f);
+        return false;
+    }
+
+    climb_t climb;
+    std::vector<mutation_t> mutations;
+    while (fread(&climb, sizeof(climb), 1, f) == 1) {
+        mutations.resize(climb.count);
+        if (fread(mutations.data(), sizeof(mutation_t), climb.count, f) != climb.count) {
+            fprintf(stderr, "%s is truncated\n", path);
+            break;
+        }
+        const int side = static_cast<int>(climb.side);
+        ++summary.climbs[side];
+        summary.depth[side] = std::max<int>(summary.depth[side], climb.depth);
+        auto &by_index = summary.by_index[side];
+        if (by_index.size() < climb.count) {
+            by_index.resize(climb.count);
+        }
+        for (const auto &m : mutations) {
+            summary.by_phase[side][static_cast<int>(m.phase)].add(m);
+            by_index[m.index].add(m);
+            for (int pos = 0; pos < k_max_positions; ++pos) {
+                if (m.positions & (1u << pos)) {
+                    summary.by_position[side][pos].add(m);
+                }
+            }
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+void print_summary(const summary_t &summary, int bucket) {
+    for (int side = 0; side < k_sides; ++side) {
+        if (!summary.climbs[side]) {
+            continue;
+        }
+        printf("== %s: %ld climbs\n", k_side_names[side], summary.climbs[side]);
+        printf("  %-8s %10s %9s %12s %12s %14s\n", "phase", "mutations", "accepted", "mean gain", "mean levels",
+               "gain/level");
+        for (int phase = 0; phase < k_phases; ++phase) {
+            const auto &s = summary.by_phase[side][phase];
+            if (!s.mutations) {
+                continue;
+            }
+            printf("  %-8s %10ld %8.2f%% %12.4e %12.2f %14.4e\n", k_phase_names[phase], s.mutations, s.rate(),
+                   s.accepted ? s.gain / s.accepted : 0.0, static_cast<double>(s.levels) / s.mutations,
+                   s.levels ? s.gain / s.levels : 0.0);
+        }
+
+        printf("  by mutation index\n");
+        const auto &by_index = summary.by_index[side];
+        for (size_t first = 0; first < by_index.size(); first += bucket) {
+            stat_t s;
+            for (size_t i = first; i < std::min(by_index.size(), first + bucket); ++i) {
+                s.mutations += by_index[i].mutations;
+                s.accepted += by_index[i].accepted;
+                s.gain += by_index[i].gain;
+                s.levels += by_index[i].levels;
+            }
+            printf("    %4zu-%-4zu %10ld %8.2f%% gain/level %.4e\n", first,
+                   std::min(by_index.size(), first + bucket) - 1, s.mutations, s.rate(),
+                   s.levels ? s.gain / s.levels : 0.0);
+        }
+
+        printf("  by genome position\n");
+        for (int pos = 0; pos < summary.depth[side]; ++pos) {
+            const auto &s = summary.by_position[side][pos];
+            printf("    %4d %10ld %8.2f%%\n", pos, s.mutations, s.rate());
+        }
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+    int bucket = 5;
+    summary_t summary;
+    int traces = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && !strcmp(argv[i], "-b")) {
+            bucket = std::max(1, atoi(argv[++i]));
+        } else if (read_trace(argv[i], summary)) {
+            ++traces;
+        }
+    }
+    if (!traces) {
+        fprintf(stderr, "Usage: %s [-b bucket] search.trace [search.trace ...]\n", argv[0]);
+        return 1;
+    }
+    print_summary(summary, bucket);
+    return 0;
+}
@@ -0,0 +1,265 @@
+// Validates physics changes against a reference. record mode plays every match of given replays from its
+// first tick with the same pseudo random actions and stores per tick hash of canonical physics state
+// (cp::state_hash) together with all its fields. compare mode takes traces of two runs or builds, bisects
+// chained hashes to the first divergent tick of every match and prints fields which differ on it.
+//
+// Usage: sim-diff record [-t ticks] [-r] -o run.trace game.txt [game.txt ...]
+//        sim-diff compare reference.trace candidate.trace
+//
+//   -r  save and restore simulator state on every tick, to validate snapshots against plain stepping
+//
+
+#include "../solution/common/replay.h"
+#include "../solution/logic/fastrand.h"
+#include "../solution/simulation/simulator.h"
+#include "../solution/simulation/state_hash.h"
+#include "../solution/structures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+unsigned int RANDOM_SEED = 42;
+
+namespace {
+
+constexpr char k_trace_magic[8] = {'S', 'I', 'M', 'T', 'R', 'A', 'C', 'E'};
+constexpr int k_max_printed_fields = 20;
+
+struct config_t {
+    int ticks = 600;
+    bool restore = false;
+};
+
+struct tick_t {
+    ///Chain of state hashes of all ticks up to this one
+    uint64_t chain;
+    std::vector<cp::state_field_t> fields;
+};
+
+using trace_t = std::vector<std::vector<tick_t>>;
+
+Action random_action(rand_stream_t &rng) {
+    constexpr Action actions[] = {Action::LEFT, Action::RIGHT, Action::STOP};
+    return actions[rng.next_int(3)];
+}
+
+std::vector<tick_t> record_match(const replay::round_t &pos, int match_idx, const config_t &config) {
+    std::vector<tick_t> ret;
+    Simulator sim;
+    sim.init(&pos.game);
+    sim.set_world(pos.worlds[0]);
+
+    rand_stream_t rng(RANDOM_SEED, static_cast<uint64_t>(match_idx));
+    cp::transaction_t snapshot;
+    uint64_t chain = 0;
+    for (int t = 0; t < config.ticks && !sim.round_over(); ++t) {
+        if (config.restore) {
+            sim.save(snapshot);
+            sim.restore(snapshot);
+        }
+        const Action my = random_action(rng);
+        const Action enemy = random_action(rng);
+        sim.step(my, enemy);
+
+        tick_t tick;
+        chain = cp::chain_hash(chain, sim.state_hash());
+        tick.chain = chain;
+        cp::state_fields(sim.native_space(), tick.fields);
+        ret.push_back(std::move(tick));
+    }
+    return ret;
+}
+
+//MARK: trace file
+
+template<typename T>
+void put(FILE *f, const T &value) {
+    fwrite(&value, sizeof(T), 1, f);
+}
+
+template<typename T>
+bool get(FILE *f, T &value) {
+    return fread(&value, sizeof(T), 1, f) == 1;
+}
+
+bool write_trace(const char *path, const trace_t &trace) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    fwrite(k_trace_magic, 1, sizeof(k_trace_magic), f);
+    put(f, static_cast<uint32_t>(trace.size()));
+    for (const auto &match : trace) {
+        put(f, static_cast<uint32_t>(match.size()));
+        for (const auto &tick : match) {
+            put(f, tick.chain);
+            put(f, static_cast<uint32_t>(tick.fields.size()));
+            for (const auto &field : tick.fields) {
+                put(f, static_cast<uint8_t>(field.name.size()));
+                fwrite(field.name.data(), 1, field.name.size(), f);
+                put(f, field.value);
+            }
+        }
+    }
+    const bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+bool read_trace(const char *path, trace_t &trace) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    char magic[sizeof(k_trace_magic)];
+    uint32_t match_count = 0;
+    bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && !memcmp(magic, k_trace_magic, sizeof(magic))
+              && get(f, match_count);
+    trace.assign(ok ? match_count : 0, {});
+    for (auto &match : trace) {
+        uint32_t tick_count = 0;
+        ok = ok && get(f, tick_count);
+        match.resize(ok ? tick_count : 0);
+        for (auto &tick : match) {
+            uint32_t field_count = 0;
+            ok = ok && get(f, tick.chain) && get(f, field_count);
+            tick.fields.resize(ok ? field_count : 0);
+            for (auto &field : tick.fields) {
+                uint8_t len = 0;
+                ok = ok && get(f, len);
+                field.name.resize(len);
+                ok = ok && fread(&field.name[0], 1, len, f) == len && get(f, field.value);
+            }
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+//MARK: compare
+
+///First tick where chains differ, count if they are equal. Chains stay different after divergence
+int first_divergent_tick(const std::vector<tick_t> &a, const std::vector<tick_t> &b, int count) {
+    int lo = 0;
+    int hi = count;
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if (a[mid].chain == b[mid].chain) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void print_field_diff(const tick_t &a, const tick_t &b) {
+    std::map<std::string, std::pair<const double *, const double *>> fields;
+    for (const auto &field : a.fields) {
+        fields[field.name].first = &field.value;
+    }
+    for (const auto &field : b.fields) {
+        fields[field.name].second = &field.value;
+    }
+
+    int printed = 0;
+    for (const auto &[name, values] : fields) {
+        const auto[va, vb] = values;
+        if (va && vb && !memcmp(va, vb, sizeof(double))) {
+            continue;
+        }
+        if (++printed > k_max_printed_fields) {
+            printf("    ...\n");
+            break;
+        }
+        if (va && vb) {
+            printf("    %-24s %+.17g %+.17g (diff %.3e)\n", name.c_str(), *va, *vb, std::abs(*va - *vb));
+        } else {
+            printf("    %-24s only in %s trace\n", name.c_str(), va ? "reference" : "candidate");
+        }
+    }
+}
+
+int record(int argc, char *argv[]) {
+    config_t config;
+    const char *out = nullptr;
+    std::vector<replay::round_t> positions;
+    for (int i = 0; i < argc; ++i) {
+        if (i + 1 < argc && !strcmp(argv[i], "-t")) {
+            config.ticks = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-o")) {
+            out = argv[++i];
+        } else if (!strcmp(argv[i], "-r")) {
+            config.restore = true;
+        } else {
+            if (!replay::read_start_positions(argv[i], positions)) {
+                fprintf(stderr, "Cannot read %s\n", argv[i]);
+            }
+        }
+    }
+    if (!out) {
+        fprintf(stderr, "Output trace is not set\n");
+        return 1;
+    }
+
+    trace_t trace;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        trace.push_back(record_match(positions[i], static_cast<int>(i), config));
+    }
+    if (!write_trace(out, trace)) {
+        fprintf(stderr, "Cannot write %s\n", out);
+        return 1;
+    }
+    printf("%zu matches recorded to %s\n", trace.size(), out);
+    return 0;
+}
+
+int compare(const char *reference_path, const char *candidate_path) {
+    trace_t reference, candidate;
+    if (!read_trace(reference_path, reference) || !read_trace(candidate_path, candidate)) {
+        fprintf(stderr, "Cannot read traces\n");
+        return 1;
+    }
+    if (reference.size() != candidate.size()) {
+        printf("match count differs: %zu vs %zu\n", reference.size(), candidate.size());
+    }
+
+    int diverged = 0;
+    for (size_t m = 0; m < std::min(reference.size(), candidate.size()); ++m) {
+        const auto &a = reference[m];
+        const auto &b = candidate[m];
+        const int count = static_cast<int>(std::min(a.size(), b.size()));
+        const int tick = first_divergent_tick(a, b, count);
+        if (tick < count) {
+            ++diverged;
+            printf("match %zu: diverged on tick %d of %d\n", m, tick, count);
+            print_field_diff(a[tick], b[tick]);
+        } else if (a.size() != b.size()) {
+            ++diverged;
+            printf("match %zu: equal for %d ticks, then one round is over: %zu vs %zu ticks\n",
+                   m, count, a.size(), b.size());
+        }
+    }
+    printf("%d of %zu matches diverged\n", diverged, std::min(reference.size(), candidate.size()));
+    return diverged == 0 && reference.size() == candidate.size() ? 0 : 1;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && !strcmp(argv[1], "record")) {
+        return record(argc - 2, argv + 2);
+    }
+    if (argc == 4 && !strcmp(argv[1], "compare")) {
+        return compare(argv[2], argv[3]);
+    }
+    fprintf(stderr, "Usage: %s record [-t ticks] [-r] -o run.trace game.txt [game.txt ...]\n"
+                    "       %s compare reference.trace candidate.trace\n", argv[0], argv[0]);
+    return 1;
+}
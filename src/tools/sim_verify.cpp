@@ -0,0 +1,233 @@
+// Physics fidelity check on recorded games without running the strategy. Every round is replayed by
+// Simulator alone: actions of both cars are not recorded, so they are inferred the way
+// Strategy::ensure_perfect_simulation does for enemy, from drive wheel angle two ticks later, and the
+// round is re-simulated from the state before the inferred action. Instead of the sign of angle difference
+// every action of a mismatched car is tried, the sign is wrong when cars push each other. Error of every tick is the same sum
+// of position and angle differences sim_precision_checker accumulates.
+// Rounds are verified by worker threads, each round in a chipmunk arena of its own.
+//
+// Usage: sim-verify [-j jobs] [-e max_error] [-l lag] [-v] game.txt [game.txt ...]
+//
+//   -l  ticks from action to the drive wheel angle it changes, 2 for the game server
+//   -e  error of a tick which is reported as divergence, default 1e-6
+//   -v  print error of every divergent tick, not only the first one
+//
+// Inputs may be json or binary replays, see replay-convert.
+//
+
+#include "../solution/common/replay.h"
+#include "../solution/simulation/simulator.h"
+#include "../solution/structures.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+unsigned int RANDOM_SEED = 42;
+
+namespace {
+
+constexpr Action k_actions[] = {Action::STOP, Action::LEFT, Action::RIGHT};
+
+struct config_t {
+    int jobs = 1;
+    double max_error = 1e-6;
+    int lag = 2;
+    bool verbose = false;
+};
+
+struct result_t {
+    int ticks = 0;
+    int inferred_actions = 0;
+    int divergent_ticks = 0;
+    int first_divergent_tick = -1;
+    int max_error_tick = -1;
+    double max_error = 0.0;
+    double sum_error = 0.0;
+    ///Report lines of divergent ticks
+    std::string lines;
+};
+
+double drive_wheel_angle(const Game &game, const CarDescription &car) {
+    return game.proto_car.drive == ProtoCar::FR ? car.rear_wheel.angle : car.front_wheel.angle;
+}
+
+double tick_error(const World &expected, const World &simulated) {
+    double ret = 0.0;
+    for (int i = 0; i < 2; ++i) {
+        const auto &e = expected.cars[i];
+        const auto &s = simulated.cars[i];
+        const vec2 body_diff = s.body.origin - e.body.origin;
+        ret += std::abs(body_diff.x) + std::abs(body_diff.y) + std::abs(s.body.angle - e.body.angle)
+               + std::abs(s.rear_wheel.angle - e.rear_wheel.angle)
+               + std::abs(s.front_wheel.angle - e.front_wheel.angle);
+    }
+    return ret;
+}
+
+///Replays round in a fresh arena of the calling thread
+result_t verify_round(const replay::round_t &round, const config_t &config) {
+    result_t result;
+
+    const auto &worlds = round.worlds;
+    const int count = static_cast<int>(worlds.size());
+    if (count == 0) {
+        return result;
+    }
+    const int my_id = worlds[0].my_id;
+
+    cp::Arena arena;
+    cp::ArenaScope scope(arena);
+    Simulator sim;
+    sim.init(&round.game);
+    sim.set_world(worlds[0]);
+
+    //Actions by car index, state before step of every tick is kept for the last lag + 1 ticks
+    std::vector<std::array<Action, 2>> actions(static_cast<size_t>(count), {Action::STOP, Action::STOP});
+    const int lag = config.lag;
+    std::vector<cp::transaction_t> states(static_cast<size_t>(lag + 1));
+    sim.save(states[0]);
+
+    const auto step = [&](int t) {
+        sim.step(actions[t][my_id], actions[t][1 - my_id]);
+    };
+    const auto resimulate = [&](int from, int to) {
+        sim.restore(states[from % (lag + 1)]);
+        for (int r = from; r < to; ++r) {
+            if (r > from) {
+                sim.save(states[r % (lag + 1)]);
+            }
+            step(r);
+        }
+    };
+
+    for (int t = 1; t < count; ++t) {
+        step(t - 1);
+
+        if (t >= lag) {
+            //Action of a car changes its drive wheel velocity, which is seen in angle lag ticks later
+            bool mismatch[2];
+            const World &predicted = sim.get_world();
+            for (int i = 0; i < 2; ++i) {
+                mismatch[i] = !eps_eq(drive_wheel_angle(round.game, worlds[t].cars[i]),
+                                      drive_wheel_angle(round.game, predicted.cars[i]));
+            }
+            if (mismatch[0] || mismatch[1]) {
+                //Sign of angle difference is not reliable when cars push each other,
+                //so all actions of mismatched cars are tried and the closest to recorded tick is taken
+                const std::array<Action, 2> assumed = actions[t - lag];
+                std::array<Action, 2> best = assumed;
+                double best_err = INF;
+                for (Action a0 : k_actions) {
+                    for (Action a1 : k_actions) {
+                        if ((!mismatch[0] && a0 != assumed[0]) || (!mismatch[1] && a1 != assumed[1])) {
+                            continue;
+                        }
+                        actions[t - lag] = {a0, a1};
+                        resimulate(t - lag, t);
+                        const double err = tick_error(worlds[t], sim.get_world());
+                        if (err < best_err) {
+                            best_err = err;
+                            best = actions[t - lag];
+                        }
+                    }
+                }
+                actions[t - lag] = best;
+                resimulate(t - lag, t);
+                result.inferred_actions += mismatch[0] + mismatch[1];
+            }
+        }
+
+        const double err = tick_error(worlds[t], sim.get_world());
+        result.sum_error += err;
+        if (err > result.max_error) {
+            result.max_error = err;
+            result.max_error_tick = t;
+        }
+        if (err > config.max_error) {
+            if (result.first_divergent_tick < 0) {
+                result.first_divergent_tick = t;
+            }
+            if (config.verbose || result.divergent_ticks == 0) {
+                char buf[128];
+                snprintf(buf, sizeof(buf), "    tick %5d error %.6e\n", t, err);
+                result.lines += buf;
+            }
+            ++result.divergent_ticks;
+        }
+        sim.save(states[t % (lag + 1)]);
+    }
+    result.ticks = count;
+
+    return result;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+    config_t config;
+    config.jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<replay::round_t> rounds;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && !strcmp(argv[i], "-j")) {
+            config.jobs = std::max(1, atoi(argv[++i]));
+        } else if (i + 1 < argc && !strcmp(argv[i], "-e")) {
+            config.max_error = atof(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-l")) {
+            config.lag = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-v")) {
+            config.verbose = true;
+        } else {
+            if (!replay::read_rounds(argv[i], rounds)) {
+                fprintf(stderr, "Cannot read %s\n", argv[i]);
+            }
+        }
+    }
+    fprintf(stderr, "%zu rounds, %d jobs\n", rounds.size(), config.jobs);
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<result_t> results(rounds.size());
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < std::min<int>(config.jobs, static_cast<int>(rounds.size())); ++i) {
+        workers.emplace_back([&] {
+            for (size_t r = next++; r < rounds.size(); r = next++) {
+                results[r] = verify_round(rounds[r], config);
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    int divergent = 0;
+    long ticks = 0;
+    for (size_t i = 0; i < rounds.size(); ++i) {
+        const auto &result = results[i];
+        ticks += result.ticks;
+
+        const auto &game = rounds[i].game;
+        printf("round %zu (%s) map %d car %d: %d ticks, %d inferred actions, mean error %.3e, max %.3e on tick %d\n",
+               i, rounds[i].source.c_str(), game.proto_map_external_id, game.proto_car.external_id, result.ticks,
+               result.inferred_actions, result.ticks > 1 ? result.sum_error / (result.ticks - 1) : 0.0,
+               result.max_error, result.max_error_tick);
+        if (result.first_divergent_tick >= 0) {
+            ++divergent;
+            printf("  %d divergent ticks, first is %d\n", result.divergent_ticks, result.first_divergent_tick);
+            fputs(result.lines.c_str(), stdout);
+        }
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%zu rounds, %ld ticks in %.2fs: %d divergent\n", rounds.size(), ticks, elapsed, divergent);
+    return divergent == 0 ? 0 : 1;
+}